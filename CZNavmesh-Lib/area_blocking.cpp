@@ -0,0 +1,25 @@
+#include "area_blocking.h"
+
+namespace navmesh {
+	void AreaBlocking::Reset(std::uint32_t areaCount) {
+		m_areaEnabled.assign(areaCount, 1);
+
+		// the numbers keep going, so planners still holding a change of the old map know they fell behind
+		m_firstChange += static_cast<std::uint32_t>(m_changeLog.size());
+		m_changeLog.clear();
+	}
+
+	void AreaBlocking::SetAreaEnabled(std::uint32_t area, bool enabled) {
+		if (area >= m_areaEnabled.size() || IsAreaEnabled(area) == enabled)
+			return;
+
+		m_areaEnabled[area] = enabled ? 1 : 0;
+
+		// doors can cycle all game long, so the log is bounded; planners that fell behind the dropped changes plan again
+		if (m_changeLog.size() == Max_Changes) {
+			m_changeLog.erase(m_changeLog.begin(), m_changeLog.begin() + Max_Changes / 2);
+			m_firstChange += Max_Changes / 2;
+		}
+		m_changeLog.push_back(area);
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace navmesh {
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * Which areas of the current map can be entered right now, ie: once a door closed or a breakable was destroyed,
+	 * and the log of changes incremental planners repair their searches from.
+	 * This is the state of a level being played, not of its mesh: a published NavigationMap never changes (see
+	 * NavSnapshots), so the game thread owns this next to it, resets it whenever another map is published, and
+	 * passes it to the searches that must avoid blocked areas. Areas it does not know of are enabled.
+	 */
+	class AreaBlocking {
+	public:
+		static constexpr std::uint32_t Max_Changes = 4096;		///< changes kept in the log; the oldest half goes when it is full
+
+		/// enable every area of a map with 'areaCount' areas; the changes made until now are dropped from the log
+		void Reset(std::uint32_t areaCount);
+
+		/**
+		 * Enable or disable entering an area.
+		 * Every change is appended to the change log; only the latest are kept, so a planner that fell behind the
+		 * oldest one must plan again.
+		 */
+		void SetAreaEnabled(std::uint32_t area, bool enabled);
+		bool IsAreaEnabled(std::uint32_t area) const noexcept { return area >= m_areaEnabled.size() || m_areaEnabled[area] != 0; }
+
+		/// number of changes made so far, the ones dropped by Reset() included; changes are numbered from zero
+		std::uint32_t GetChangeCount() const noexcept { return m_firstChange + static_cast<std::uint32_t>(m_changeLog.size()); }
+
+		/// number of the oldest change still in the log
+		std::uint32_t GetFirstChange() const noexcept { return m_firstChange; }
+
+		/// the area changed by change 'i', which must be in the log
+		std::uint32_t GetChange(std::uint32_t i) const { return m_changeLog[i - m_firstChange]; }
+
+		std::size_t GetMemoryUsage() const noexcept { return m_areaEnabled.capacity() + m_changeLog.capacity() * sizeof(std::uint32_t); }
+
+	private:
+		std::vector<std::uint8_t> m_areaEnabled{};				///< zero if the area cannot be entered right now
+		std::vector<std::uint32_t> m_changeLog{};				///< indices of areas whose enabled state changed, in order
+		std::uint32_t m_firstChange{};							///< number of the change at the front of the log
+	};
+}
@@ -0,0 +1,168 @@
+#include "area_visibility.h"
+#include "navigation_map.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <vector>
+
+namespace navmesh {
+	void AreaVisibility::Build(const NavigationMap& map) {
+		const auto Start = std::chrono::steady_clock::now();
+		Clear();
+
+		const auto Area_Count = map.GetAreaCount();
+		auto& areaFlags = m_areaFlags.Edit();
+		areaFlags.assign(Area_Count, 0);
+
+		// find which area each hiding spot belongs to
+		std::vector<std::uint32_t> spotOwner(map.GetHidingSpotCount(), Invalid_Index);
+		for (std::uint32_t i = 0; i < Area_Count; ++i) {
+			const NavArea* area = map.GetAreaByIndex(i);
+			for (auto& spot : map.GetHidingSpots(area))
+				spotOwner[spot->m_index] = i;
+
+			if (!area->hiding_spots.empty())
+				areaFlags[i] |= HAS_HIDING_SPOTS;
+		}
+
+		// collect every visible pair both ways, as (from << 32 | to)
+		std::vector<std::uint64_t> pairs;
+		auto addPair = [&pairs](std::uint32_t a, std::uint32_t b) {
+			pairs.push_back(static_cast<std::uint64_t>(a) << 32 | b);
+			pairs.push_back(static_cast<std::uint64_t>(b) << 32 | a);
+		};
+
+		for (std::uint32_t i = 0; i < Area_Count; ++i) {
+			addPair(i, i);
+			for (auto& link : map.GetOutgoingLinks(i))
+				addPair(i, link.to);
+
+			for (auto& e : map.GetEncounters(i)) {
+				for (auto& order : map.GetEncounterSpots(e)) {
+					if (const auto Owner = spotOwner[order.spot]; Owner != Invalid_Index) {
+						addPair(i, Owner);
+						areaFlags[i] |= HAS_ENCOUNTERS;
+					}
+				}
+			}
+		}
+
+		std::sort(pairs.begin(), pairs.end());
+		pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+		// pack the sorted pairs into words; pairs of an area are contiguous, and so are those sharing a word
+		auto& wordStart = m_wordStart.Edit();
+		auto& wordNumber = m_wordNumber.Edit();
+		auto& words = m_words.Edit();
+		wordStart.assign(Area_Count + 1, 0);
+		for (auto pair : pairs) {
+			const auto From = static_cast<std::uint32_t>(pair >> 32);
+			const auto To = static_cast<std::uint32_t>(pair);
+			const std::uint32_t Number = To / 64;
+
+			if (wordStart[From + 1] == 0 || wordNumber.back() != Number) {
+				wordNumber.push_back(Number);
+				words.push_back(0);
+				wordStart[From + 1] = static_cast<std::uint32_t>(words.size());
+			}
+			words.back() |= std::uint64_t{ 1 } << (To % 64);
+		}
+
+		// areas without words start where the previous one ended
+		for (std::uint32_t i = 1; i <= Area_Count; ++i)
+			wordStart[i] = (std::max)(wordStart[i], wordStart[i - 1]);
+
+		const std::chrono::duration<double, std::milli> Elapsed = std::chrono::steady_clock::now() - Start;
+		m_stats.buildMilliseconds = Elapsed.count();
+		m_stats.visiblePairs = pairs.size();
+		m_stats.memoryBytes = m_wordStart.capacity() * sizeof(std::uint32_t) + m_wordNumber.capacity() * sizeof(std::uint32_t)
+			+ m_words.capacity() * sizeof(std::uint64_t) + m_areaFlags.capacity() * sizeof(std::uint8_t);
+	}
+
+	void AreaVisibility::AddImageSections(std::vector<NavImage::Section>* sections) const {
+		sections->push_back(m_wordStart.GetImageSection(NavImage::VISIBILITY_START_SECTION));
+		sections->push_back(m_wordNumber.GetImageSection(NavImage::VISIBILITY_NUMBER_SECTION));
+		sections->push_back(m_words.GetImageSection(NavImage::VISIBILITY_WORD_SECTION));
+		sections->push_back(m_areaFlags.GetImageSection(NavImage::VISIBILITY_FLAG_SECTION));
+	}
+
+	bool AreaVisibility::View(const NavImage& image, std::uint32_t areaCount) {
+		const bool Viewed = m_wordStart.View(image, NavImage::VISIBILITY_START_SECTION) && m_wordNumber.View(image, NavImage::VISIBILITY_NUMBER_SECTION)
+			&& m_words.View(image, NavImage::VISIBILITY_WORD_SECTION) && m_areaFlags.View(image, NavImage::VISIBILITY_FLAG_SECTION);
+
+		// the word lists must fit the map they are used with
+		if (!Viewed || m_wordStart.size() != areaCount + 1 || m_areaFlags.size() != areaCount || m_wordStart.back() != m_words.size() || m_wordNumber.size() != m_words.size()) {
+			DropView();
+			return false;
+		}
+
+		m_wordStart.ReleaseOwned();
+		m_wordNumber.ReleaseOwned();
+		m_words.ReleaseOwned();
+		m_areaFlags.ReleaseOwned();
+
+		// nothing is built or owned; only count what Build() would have
+		m_stats = {};
+		for (auto word : m_words)
+			m_stats.visiblePairs += std::popcount(word);
+		return true;
+	}
+
+	void AreaVisibility::DropView() noexcept {
+		m_wordStart.DropView();
+		m_wordNumber.DropView();
+		m_words.DropView();
+		m_areaFlags.DropView();
+	}
+
+	void AreaVisibility::Clear() {
+		m_wordStart.clear();
+		m_wordNumber.clear();
+		m_words.clear();
+		m_areaFlags.clear();
+		m_stats = {};
+		m_queries.store(0, std::memory_order_relaxed);
+		m_rejected.store(0, std::memory_order_relaxed);
+	}
+
+	bool AreaVisibility::IsMarked(std::uint32_t from, std::uint32_t to) const {
+		const auto First = m_wordNumber.begin() + m_wordStart[from];
+		const auto Last = m_wordNumber.begin() + m_wordStart[from + 1];
+		const auto Word = std::lower_bound(First, Last, to / 64);
+		if (Word == Last || *Word != to / 64)
+			return false;
+
+		return (m_words[Word - m_wordNumber.begin()] >> (to % 64)) & 1;
+	}
+
+	bool AreaVisibility::IsPotentiallyVisible(std::uint32_t from, std::uint32_t to) const {
+		if (from >= m_areaFlags.size() || to >= m_areaFlags.size())
+			return true;
+
+		if (IsMarked(from, to))
+			return true;
+
+		// without encounters on one side and hiding spots on the other, the data says nothing about this pair
+		const bool Known = ((m_areaFlags[from] & HAS_ENCOUNTERS) && (m_areaFlags[to] & HAS_HIDING_SPOTS)) ||
+			((m_areaFlags[to] & HAS_ENCOUNTERS) && (m_areaFlags[from] & HAS_HIDING_SPOTS));
+		return !Known;
+	}
+
+	bool AreaVisibility::Check(std::uint32_t from, std::uint32_t to) const {
+		// only counted, so nothing is ordered by them
+		m_queries.fetch_add(1, std::memory_order_relaxed);
+		if (IsPotentiallyVisible(from, to))
+			return true;
+
+		m_rejected.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	AreaVisibility::Stats AreaVisibility::GetStats() const noexcept {
+		Stats stats = m_stats;
+		stats.queries = m_queries.load(std::memory_order_relaxed);
+		stats.rejected = m_rejected.load(std::memory_order_relaxed);
+		return stats;
+	}
+}
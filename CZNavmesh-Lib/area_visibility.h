@@ -0,0 +1,72 @@
+#pragma once
+#include "nav_image.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace navmesh {
+	class NavigationMap;
+
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * The potentially visible set of every area, derived from the encounter data of a .nav file.
+	 * Each encounter lists the hiding spots that can see the path through its area, so the areas owning those
+	 * spots can see that area and vice versa. Areas are always visible to themselves and their neighbors.
+	 *
+	 * The generator only records hiding spots, so a missing bit is only used when one of the two areas has
+	 * encounter data and the other has hiding spots. Any other pair is reported as potentially visible.
+	 * Even then, the spots are samples: a pair reported as not visible may still see each other from somewhere
+	 * else in the areas, so the sets are a heuristic for skipping traces, not a guarantee.
+	 */
+	class AreaVisibility {
+	public:
+		struct Stats {
+			double buildMilliseconds;							///< time taken by the last Build()
+			std::size_t memoryBytes;							///< memory held by the bitsets and area flags
+			std::uint64_t visiblePairs;							///< number of (from, to) pairs marked visible
+			std::uint64_t queries;								///< number of Check() calls
+			std::uint64_t rejected;								///< Check() calls that found no visible spot
+		};
+
+		/// (re)build the sets from the encounter data of a loaded map
+		void Build(const NavigationMap& map);
+		void Clear();
+
+		/// add the sets to the sections of a NavImage
+		void AddImageSections(std::vector<NavImage::Section>* sections) const;
+
+		/// use the sets of an image instead of the built ones, which are only freed if it fits 'areaCount' areas
+		bool View(const NavImage& image, std::uint32_t areaCount);
+
+		/// go back to the built sets, if any
+		void DropView() noexcept;
+
+		/// return false if none of the hiding spots sampled in the two areas can see the other area
+		bool IsPotentiallyVisible(std::uint32_t from, std::uint32_t to) const;
+
+		/// same as IsPotentiallyVisible(), but counted in the stats; safe from any thread reading the map
+		bool Check(std::uint32_t from, std::uint32_t to) const;
+
+		Stats GetStats() const noexcept;
+
+	private:
+		enum {
+			HAS_ENCOUNTERS = 0x01,								///< the area has encounter paths with spots to look at
+			HAS_HIDING_SPOTS = 0x02,							///< the area owns hiding spots
+		};
+
+		// Each area's set is a sparse list of the non-zero 64 bit words of a bitset over all areas,
+		// sorted by word number so a lookup is a binary search over a few entries
+		ImageArray<std::uint32_t> m_wordStart{};				///< first word of each area, plus one past the end
+		ImageArray<std::uint32_t> m_wordNumber{};				///< which 64 areas the word at the same index covers
+		ImageArray<std::uint64_t> m_words{};
+		ImageArray<std::uint8_t> m_areaFlags{};
+		Stats m_stats{};										///< counters aside, which are kept below
+		mutable std::atomic<std::uint64_t> m_queries{};
+		mutable std::atomic<std::uint64_t> m_rejected{};
+
+		bool IsMarked(std::uint32_t from, std::uint32_t to) const;
+	};
+}
@@ -0,0 +1,60 @@
+#include "engine_queue.h"
+
+namespace navmesh {
+	bool EngineQueue::Call(std::function<void()> job) {
+		std::unique_lock lock(m_mutex);
+		if (m_closed)
+			return false;
+
+		const std::uint64_t Ticket = m_nextTicket++;
+		m_jobs.push_back({ std::move(job), Ticket });
+		m_finished.wait(lock, [this, Ticket] { return m_closed || m_lastFinished >= Ticket; });
+		return m_lastFinished >= Ticket;
+	}
+
+	void EngineQueue::Post(std::function<void()> job) {
+		std::scoped_lock lock(m_mutex);
+		if (!m_closed)
+			m_jobs.push_back({ std::move(job), 0 });
+	}
+
+	std::size_t EngineQueue::Run(std::chrono::microseconds budget) {
+		const auto Start = std::chrono::steady_clock::now();
+		std::size_t count = 0;
+
+		do {
+			Job job;
+			{
+				std::scoped_lock lock(m_mutex);
+				if (m_jobs.empty())
+					break;
+
+				job = std::move(m_jobs.front());
+				m_jobs.pop_front();
+			}
+
+			job.run();
+			++count;
+
+			if (job.ticket != 0) {
+				std::scoped_lock lock(m_mutex);
+				m_lastFinished = job.ticket;
+				m_finished.notify_all();
+			}
+		} while (std::chrono::steady_clock::now() - Start < budget);
+
+		return count;
+	}
+
+	void EngineQueue::Close() {
+		std::scoped_lock lock(m_mutex);
+		m_closed = true;
+		m_jobs.clear();
+		m_finished.notify_all();
+	}
+
+	void EngineQueue::Open() {
+		std::scoped_lock lock(m_mutex);
+		m_closed = false;
+	}
+}
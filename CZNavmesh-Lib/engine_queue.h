@@ -0,0 +1,46 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace navmesh {
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * Hands work that needs the engine from a loading thread to the game thread.
+	 * The game thread calls Run() once per frame, which runs queued jobs for a bounded time, so a long load never
+	 * holds up a frame by more than the budget.
+	 */
+	class EngineQueue {
+	public:
+		/// run 'job' on the game thread and wait for it; return false without running it if the queue is closed
+		bool Call(std::function<void()> job);
+
+		/// run 'job' on the game thread later, without waiting
+		void Post(std::function<void()> job);
+
+		/// game thread: run queued jobs until 'budget' is spent, at least one if any is queued; return how many ran
+		std::size_t Run(std::chrono::microseconds budget);
+
+		/// refuse new jobs and drop queued ones, releasing any thread waiting in Call()
+		void Close();
+
+		/// accept jobs again after Close()
+		void Open();
+
+	private:
+		struct Job {
+			std::function<void()> run;
+			std::uint64_t ticket;								///< zero for posted jobs nobody waits for
+		};
+
+		std::mutex m_mutex;
+		std::condition_variable m_finished;
+		std::deque<Job> m_jobs{};
+		std::uint64_t m_nextTicket = 1;
+		std::uint64_t m_lastFinished = 0;					///< tickets are finished in order, so one counter is enough
+		bool m_closed = false;
+	};
+}
@@ -0,0 +1,53 @@
+#include "entity_class_table.h"
+
+namespace navmesh {
+	EntityClassTable entity_class_table{};
+
+	std::uint8_t EntityClassTable::Classify(edict_t* entity) {
+		std::uint8_t entityClass = CLASSIFIED;
+		if (FClassnameIs(VARS(entity), "func_door") || FClassnameIs(VARS(entity), "func_door_rotating"))
+			entityClass |= DOOR;
+		else if (FClassnameIs(VARS(entity), "func_breakable"))
+			entityClass |= BREAKABLE;
+
+		return entityClass;
+	}
+
+	void EntityClassTable::OnSpawn(edict_t* entity) {
+		const int Index = ENTINDEX(entity);
+		if (Index < 0)
+			return;
+
+		if (static_cast<std::size_t>(Index) >= m_classes.size())
+			m_classes.resize(Index + 1, 0);
+
+		m_classes[Index] = Classify(entity);
+	}
+
+	void EntityClassTable::OnFree(edict_t* entity) {
+		const int Index = ENTINDEX(entity);
+		if (Index >= 0 && static_cast<std::size_t>(Index) < m_classes.size())
+			m_classes[Index] = 0;
+	}
+
+	std::uint8_t EntityClassTable::GetClass(edict_t* entity) {
+		const int Index = ENTINDEX(entity);
+		if (Index < 0)
+			return Classify(entity);
+
+		if (static_cast<std::size_t>(Index) >= m_classes.size())
+			m_classes.resize(Index + 1, 0);
+
+		if (!(m_classes[Index] & CLASSIFIED))
+			m_classes[Index] = Classify(entity);
+
+		return m_classes[Index];
+	}
+
+	bool EntityClassTable::IsGroundTraceIgnorable(edict_t* entity) {
+		const std::uint8_t Class = GetClass(entity);
+
+		// breakables can be made unbreakable while the map runs, so that is checked every time
+		return (Class & DOOR) || ((Class & BREAKABLE) && VARS(entity)->takedamage == DAMAGE_YES);
+	}
+}
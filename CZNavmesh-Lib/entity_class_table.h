@@ -0,0 +1,45 @@
+#pragma once
+#include <extdll.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace navmesh {
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * Remembers what kind of entity each edict is, so traces can decide what to skip with a bit test instead of
+	 * comparing classnames.
+	 * Edicts are classified the first time they are asked about, and forgotten when the game spawns or frees them,
+	 * which the plugin reports with OnSpawn() and OnFree().
+	 * Like the traces using it, it must only be used from the game thread.
+	 */
+	class EntityClassTable {
+	public:
+		enum EntityClass : std::uint8_t {
+			CLASSIFIED = 0x01,									///< the other bits are valid
+			DOOR = 0x02,										///< func_door or func_door_rotating
+			BREAKABLE = 0x04,									///< func_breakable
+		};
+
+		/// an edict was spawned, possibly reusing the slot of another entity
+		void OnSpawn(edict_t* entity);
+
+		/// an edict was freed
+		void OnFree(edict_t* entity);
+
+		/// forget every edict, when the map changes
+		void Clear() { m_classes.clear(); }
+
+		std::uint8_t GetClass(edict_t* entity);
+
+		/// return true if ground traces should pass through this entity: doors, and floors that can be broken
+		bool IsGroundTraceIgnorable(edict_t* entity);
+
+	private:
+		std::vector<std::uint8_t> m_classes{};
+
+		static std::uint8_t Classify(edict_t* entity);
+	};
+
+	extern EntityClassTable entity_class_table;
+}
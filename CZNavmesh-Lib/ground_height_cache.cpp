@@ -0,0 +1,51 @@
+#include "ground_height_cache.h"
+
+#include <cmath>
+
+namespace navmesh {
+	std::uint64_t GroundHeightCache::GetKey(const Vector& pos) {
+		// 21 bits per axis covers any map at this resolution
+		auto quantize = [](float value, float size) {
+			return static_cast<std::uint64_t>(static_cast<std::int64_t>(std::floor(value / size))) & 0x1FFFFF;
+		};
+		return quantize(pos.x, Cell_Size) | quantize(pos.y, Cell_Size) << 21 | quantize(pos.z, Bucket_Height) << 42;
+	}
+
+	Vector GroundHeightCache::GetCellCenter(const Vector& pos) {
+		return Vector((std::floor(pos.x / Cell_Size) + 0.5f) * Cell_Size,
+			(std::floor(pos.y / Cell_Size) + 0.5f) * Cell_Size,
+			(std::floor(pos.z / Bucket_Height) + 0.5f) * Bucket_Height);
+	}
+
+	bool GroundHeightCache::Find(const Vector& pos, std::span<const GroundLayer>* layers) {
+		++m_stats.lookups;
+
+		auto column = m_columns.find(GetKey(pos));
+		if (column == m_columns.end())
+			return false;
+
+		++m_stats.hits;
+		m_stats.tracesSaved += column->second.traceCount;
+		*layers = { m_layers.data() + column->second.firstLayer, column->second.layerCount };
+		return true;
+	}
+
+	void GroundHeightCache::Store(const Vector& pos, std::span<const GroundLayer> layers, std::uint32_t traceCount) {
+		m_stats.tracesMade += traceCount;
+
+		if (m_columns.size() >= Max_Columns) {
+			m_columns.clear();
+			m_layers.clear();
+		}
+
+		const Column New_Column{ static_cast<std::uint32_t>(m_layers.size()), static_cast<std::uint16_t>(layers.size()), static_cast<std::uint16_t>(traceCount) };
+		if (m_columns.emplace(GetKey(pos), New_Column).second)
+			m_layers.insert(m_layers.end(), layers.begin(), layers.end());
+	}
+
+	void GroundHeightCache::Clear() {
+		m_columns.clear();
+		m_layers.clear();
+		m_stats = {};
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <extdll.h>
+
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace navmesh {
+	/// a floor found below a point by GetGroundHeight()
+	struct GroundLayer {
+		float ground;
+		Vector normal;
+	};
+
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * Remembers the ground layers found by GetGroundHeight(), so a column is only traced once.
+	 * Points are quantized to Cell_Size in x and y and Bucket_Height in z, and each such cell is traced from
+	 * its center; every point in the cell shares the result.
+	 * It is not thread safe, and must only be used from the game thread like the traces it saves.
+	 */
+	class GroundHeightCache {
+	public:
+		static constexpr float Cell_Size = 8.0f;
+		static constexpr float Bucket_Height = 16.0f;
+		static constexpr std::size_t Max_Columns = 1 << 16;		///< the cache starts over when it grows past this
+
+		struct Stats {
+			std::uint64_t lookups;
+			std::uint64_t hits;
+			std::uint64_t tracesMade;							///< traces made filling the cache
+			std::uint64_t tracesSaved;							///< traces the hits would have made
+		};
+
+		/// the point a cell is traced from, for the cell containing 'pos'
+		static Vector GetCellCenter(const Vector& pos);
+
+		/// return the cached layers of the cell containing 'pos', or false on a miss
+		bool Find(const Vector& pos, std::span<const GroundLayer>* layers);
+
+		/// store the layers of the cell containing 'pos', found with 'traceCount' traces
+		void Store(const Vector& pos, std::span<const GroundLayer> layers, std::uint32_t traceCount);
+
+		void Clear();
+		std::size_t GetColumnCount() const noexcept { return m_columns.size(); }
+		const Stats& GetStats() const noexcept { return m_stats; }
+
+	private:
+		struct Column {
+			std::uint32_t firstLayer;
+			std::uint16_t layerCount;
+			std::uint16_t traceCount;
+		};
+
+		std::unordered_map<std::uint64_t, Column> m_columns{};
+		std::vector<GroundLayer> m_layers{};
+		Stats m_stats{};
+
+		static std::uint64_t GetKey(const Vector& pos);
+	};
+}
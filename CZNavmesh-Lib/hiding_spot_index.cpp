@@ -0,0 +1,234 @@
+#include "hiding_spot_index.h"
+#include "navigation_map.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+namespace navmesh {
+	void HidingSpotIndex::Build(const NavigationMap& map) {
+		Clear();
+
+		const auto Area_Count = map.GetAreaCount();
+		for (std::uint32_t i = 0; i < Area_Count; ++i) {
+			for (auto& spot : map.GetHidingSpots(map.GetAreaByIndex(i)))
+				m_entries.push_back({ spot->m_pos, spot, i, spot->m_flags });
+		}
+
+		if (m_entries.empty())
+			return;
+
+		float maxX = m_entries.front().pos.x, maxY = m_entries.front().pos.y;
+		m_minX = maxX;
+		m_minY = maxY;
+		for (auto& entry : m_entries) {
+			m_minX = (std::min)(m_minX, entry.pos.x);
+			m_minY = (std::min)(m_minY, entry.pos.y);
+			maxX = (std::max)(maxX, entry.pos.x);
+			maxY = (std::max)(maxY, entry.pos.y);
+		}
+
+		m_gridSizeX = static_cast<int>((maxX - m_minX) / Cell_Size) + 1;
+		m_gridSizeY = static_cast<int>((maxY - m_minY) / Cell_Size) + 1;
+
+		// counting sort of the entries by cell
+		auto cellOf = [this](const Entry& entry) { return WorldToGridX(entry.pos.x) + WorldToGridY(entry.pos.y) * m_gridSizeX; };
+
+		m_cellStart.assign(m_gridSizeX * m_gridSizeY + 1, 0);
+		for (auto& entry : m_entries)
+			++m_cellStart[cellOf(entry) + 1];
+
+		for (std::size_t i = 1; i < m_cellStart.size(); ++i)
+			m_cellStart[i] += m_cellStart[i - 1];
+
+		std::vector<Entry> sorted(m_entries.size());
+		std::vector<std::uint32_t> next(m_cellStart.begin(), m_cellStart.end() - 1);
+		for (auto& entry : m_entries)
+			sorted[next[cellOf(entry)]++] = entry;
+
+		m_entries.swap(sorted);
+
+		m_entryOfSpot.reserve(m_entries.size());
+		for (std::uint32_t i = 0; i < m_entries.size(); ++i)
+			m_entryOfSpot.emplace(m_entries[i].spot, i);
+	}
+
+	void HidingSpotIndex::Clear() {
+		m_entries.clear();
+		m_cellStart.clear();
+		m_entryOfSpot.clear();
+		m_gridSizeX = m_gridSizeY = 0;
+	}
+
+	int HidingSpotIndex::WorldToGridX(float wx) const {
+		return std::clamp(static_cast<int>((wx - m_minX) / Cell_Size), 0, m_gridSizeX - 1);
+	}
+
+	int HidingSpotIndex::WorldToGridY(float wy) const {
+		return std::clamp(static_cast<int>((wy - m_minY) / Cell_Size), 0, m_gridSizeY - 1);
+	}
+
+	void HidingSpotIndex::FindInRadius(const Vector& pos, float radius, unsigned char flags, std::vector<HidingSpot*>* result) const {
+		result->clear();
+		if (m_entries.empty())
+			return;
+
+		std::vector<std::pair<float, HidingSpot*>> found;
+		const float Radius_Sq = radius * radius;
+
+		const int Lo_X = WorldToGridX(pos.x - radius), Hi_X = WorldToGridX(pos.x + radius);
+		const int Lo_Y = WorldToGridY(pos.y - radius), Hi_Y = WorldToGridY(pos.y + radius);
+		for (int y = Lo_Y; y <= Hi_Y; ++y) {
+			for (int x = Lo_X; x <= Hi_X; ++x) {
+				ForEachInCell(x, y, flags, [&](std::uint32_t i) {
+					const Vector Delta = m_entries[i].pos - pos;
+					const float DistSq = Delta.x * Delta.x + Delta.y * Delta.y + Delta.z * Delta.z;
+					if (DistSq <= Radius_Sq)
+						found.push_back({ DistSq, m_entries[i].spot });
+				});
+			}
+		}
+
+		std::sort(found.begin(), found.end(), [](auto& a, auto& b) { return a.first < b.first; });
+		for (auto& [distSq, spot] : found)
+			result->push_back(spot);
+	}
+
+	void HidingSpotIndex::FindNearest(const Vector& pos, std::uint32_t count, float maxRange, unsigned char flags, std::vector<HidingSpot*>* result) const {
+		result->clear();
+		if (m_entries.empty() || count == 0)
+			return;
+
+		// max-heap of the best candidates so far, so the worst one is on top
+		std::vector<std::pair<float, HidingSpot*>> best;
+		auto byDistance = [](auto& a, auto& b) { return a.first < b.first; };
+		const float Max_Range_Sq = maxRange * maxRange;
+
+		// visit rings of cells around the cell of 'pos'; everything in ring r + 1 is at least r cells away
+		const int Center_X = WorldToGridX(pos.x), Center_Y = WorldToGridY(pos.y);
+		const int Max_Ring = (std::max)({ Center_X, m_gridSizeX - 1 - Center_X, Center_Y, m_gridSizeY - 1 - Center_Y });
+		for (int ring = 0; ring <= Max_Ring; ++ring) {
+			if (ring > 0) {
+				const float Closest = (ring - 1) * Cell_Size;
+				if (Closest > maxRange || (best.size() == count && Closest * Closest > best.front().first))
+					break;
+			}
+
+			auto visit = [&](std::uint32_t i) {
+				const Vector Delta = m_entries[i].pos - pos;
+				const float DistSq = Delta.x * Delta.x + Delta.y * Delta.y + Delta.z * Delta.z;
+				if (DistSq > Max_Range_Sq)
+					return;
+
+				if (best.size() < count) {
+					best.push_back({ DistSq, m_entries[i].spot });
+					std::push_heap(best.begin(), best.end(), byDistance);
+				} else if (DistSq < best.front().first) {
+					std::pop_heap(best.begin(), best.end(), byDistance);
+					best.back() = { DistSq, m_entries[i].spot };
+					std::push_heap(best.begin(), best.end(), byDistance);
+				}
+			};
+
+			for (int y = Center_Y - ring; y <= Center_Y + ring; ++y) {
+				if (y < 0 || y >= m_gridSizeY)
+					continue;
+
+				// only the edges of the ring are new, the inside was visited by smaller rings
+				const int Step = (y == Center_Y - ring || y == Center_Y + ring) ? 1 : (std::max)(2 * ring, 1);
+				for (int x = Center_X - ring; x <= Center_X + ring; x += Step) {
+					if (x >= 0 && x < m_gridSizeX)
+						ForEachInCell(x, y, flags, visit);
+				}
+			}
+		}
+
+		std::sort_heap(best.begin(), best.end(), byDistance);
+		for (auto& [distSq, spot] : best)
+			result->push_back(spot);
+	}
+
+	/**
+	 * Dijkstra over the area graph from the area at 'pos', stopping once every area owning one of the spots
+	 * has been settled, so only the areas between the bot and its spots are visited.
+	 */
+	bool HidingSpotIndex::RankByTravelDistance(const NavigationMap& map, const Vector& pos, float maxTravel, std::vector<HidingSpot*>* spots) const {
+		const NavArea* startArea = map.GetNavArea(&pos);
+		if (startArea == nullptr)
+			return false;
+
+		// area of each spot, and its travel distance once settled
+		std::unordered_map<std::uint32_t, float> targets;
+		for (auto& spot : *spots) {
+			if (auto entry = m_entryOfSpot.find(spot); entry != m_entryOfSpot.end())
+				targets.emplace(m_entries[entry->second].area, std::numeric_limits<float>::infinity());
+		}
+
+		using Node = std::pair<float, std::uint32_t>;
+		std::priority_queue<Node, std::vector<Node>, std::greater<Node>> open;
+		std::unordered_map<std::uint32_t, float> costSoFar;
+
+		const float Start_Cost = (startArea->m_center - pos).Length();
+		costSoFar[startArea->m_index] = Start_Cost;
+		open.push({ Start_Cost, startArea->m_index });
+
+		std::size_t remaining = targets.size();
+		while (!open.empty() && remaining > 0) {
+			const auto [cost, area] = open.top();
+			open.pop();
+
+			if (cost > costSoFar[area])
+				continue;
+
+			if (cost > maxTravel)
+				break;
+
+			if (auto target = targets.find(area); target != targets.end() && target->second == std::numeric_limits<float>::infinity()) {
+				target->second = cost;
+				--remaining;
+			}
+
+			for (auto& link : map.GetOutgoingLinks(area)) {
+				const float next = cost + map.GetLinkCost(link);
+				if (next == std::numeric_limits<float>::infinity())
+					continue;
+
+				if (auto known = costSoFar.find(link.to); known != costSoFar.end() && known->second <= next)
+					continue;
+
+				costSoFar[link.to] = next;
+				open.push({ next, link.to });
+			}
+		}
+
+		// the last leg runs from the center of the spot's area, or straight from 'pos' within the start area
+		std::vector<std::pair<float, HidingSpot*>> ranked;
+		for (auto& spot : *spots) {
+			auto entry = m_entryOfSpot.find(spot);
+			if (entry == m_entryOfSpot.end())
+				continue;
+
+			const Entry& e = m_entries[entry->second];
+			float travel = targets[e.area] + (e.pos - map.GetAreaByIndex(e.area)->m_center).Length();
+			if (e.area == startArea->m_index)
+				travel = (e.pos - pos).Length();
+
+			if (travel <= maxTravel)
+				ranked.push_back({ travel, spot });
+		}
+
+		std::stable_sort(ranked.begin(), ranked.end(), [](auto& a, auto& b) { return a.first < b.first; });
+		spots->clear();
+		for (auto& [travel, spot] : ranked)
+			spots->push_back(spot);
+		return true;
+	}
+
+	std::uint32_t HidingSpotIndex::GetSpotArea(const HidingSpot* spot) const {
+		auto entry = m_entryOfSpot.find(spot);
+		return (entry != m_entryOfSpot.end()) ? m_entries[entry->second].area : Invalid_Index;
+	}
+}
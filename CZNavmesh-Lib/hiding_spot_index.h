@@ -0,0 +1,72 @@
+#pragma once
+#include <extdll.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace navmesh {
+	class HidingSpot;
+	class NavigationMap;
+
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * A uniform grid over the hiding spots of a map, so that spatial queries only look at nearby cells.
+	 * Queries take a set of HidingSpot flags, and only return spots having at least one of them; zero matches all spots.
+	 */
+	class HidingSpotIndex {
+	public:
+		static constexpr float Cell_Size = 256.0f;
+
+		/// (re)build the index from the hiding spots of a loaded map
+		void Build(const NavigationMap& map);
+		void Clear();
+
+		/// return every matching spot within 'radius' of 'pos', closest first
+		void FindInRadius(const Vector& pos, float radius, unsigned char flags, std::vector<HidingSpot*>* result) const;
+
+		/// return up to 'count' matching spots within 'maxRange' of 'pos', closest first
+		void FindNearest(const Vector& pos, std::uint32_t count, float maxRange, unsigned char flags, std::vector<HidingSpot*>* result) const;
+
+		/**
+		 * Reorder 'spots' by how far a bot standing at 'pos' has to walk to reach them, closest first.
+		 * Spots that cannot be reached within 'maxTravel' are removed.
+		 * Return false and leave 'spots' untouched if 'pos' is not on the mesh.
+		 */
+		bool RankByTravelDistance(const NavigationMap& map, const Vector& pos, float maxTravel, std::vector<HidingSpot*>* spots) const;
+
+		std::uint32_t GetSpotCount() const noexcept { return static_cast<std::uint32_t>(m_entries.size()); }
+
+		/// dense index of the area 'spot' belongs to, Invalid_Index if it is not indexed
+		std::uint32_t GetSpotArea(const HidingSpot* spot) const;
+
+	private:
+		struct Entry {
+			Vector pos;											///< copy of the spot position, to keep scans within the grid
+			HidingSpot* spot;
+			std::uint32_t area;									///< dense index of the area the spot belongs to
+			unsigned char flags;
+		};
+
+		std::vector<Entry> m_entries{};							///< grouped by cell
+		std::vector<std::uint32_t> m_cellStart{};				///< first entry of each cell, plus one past the end
+		std::unordered_map<const HidingSpot*, std::uint32_t> m_entryOfSpot{};
+		int m_gridSizeX{};
+		int m_gridSizeY{};
+		float m_minX{};
+		float m_minY{};
+
+		int WorldToGridX(float wx) const;
+		int WorldToGridY(float wy) const;
+
+		/// call 'func' with the index of every matching entry in the given cell
+		template<typename Func>
+		void ForEachInCell(int x, int y, unsigned char flags, Func&& func) const {
+			const int Cell = x + y * m_gridSizeX;
+			for (std::uint32_t i = m_cellStart[Cell]; i < m_cellStart[Cell + 1]; ++i) {
+				if (flags == 0 || (m_entries[i].flags & flags) != 0)
+					func(i);
+			}
+		}
+	};
+}
@@ -0,0 +1,817 @@
+#include "nav_benchmark.h"
+#include "path_corridor.h"
+#include "path_search.h"
+#include "path_smoothing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <limits>
+#include <memory>
+#include <numbers>
+#include <random>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace navmesh {
+	namespace {
+		using Clock = std::chrono::steady_clock;
+
+		/// resident set size of this process
+		std::int64_t GetResidentBytes() {
+#ifdef _WIN32
+			PROCESS_MEMORY_COUNTERS counters{};
+			if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof counters))
+				return 0;
+
+			return static_cast<std::int64_t>(counters.WorkingSetSize);
+#else
+			FILE* fp = fopen("/proc/self/statm", "r");
+			if (fp == nullptr)
+				return 0;
+
+			long pages = 0, resident = 0;
+			if (fscanf(fp, "%ld %ld", &pages, &resident) != 2)
+				resident = 0;
+			fclose(fp);
+			return static_cast<std::int64_t>(resident) * sysconf(_SC_PAGESIZE);
+#endif
+		}
+
+		/// remove a .nav file and everything written next to it
+		void RemoveNavFiles(const std::string& path) {
+			std::error_code error;
+			std::filesystem::remove(path, error);
+			std::filesystem::remove(NavCache::GetPathFor(path), error);
+			std::filesystem::remove(NavImage::GetPathFor(path), error);
+			std::filesystem::remove(NavigationMap::GetMergedIDPathFor(path), error);
+		}
+
+		/**
+		 * A copy of the .nav file of a map in the temporary directory, removed along with everything written next
+		 * to it. Benchmarks load copies from here, without ladders, so they neither trace on the game thread nor
+		 * replace the cache and image of the map being played.
+		 */
+		class ScratchNavFile {
+		public:
+			explicit ScratchNavFile(const std::string& navPath) {
+				std::error_code error;
+				const auto Directory = std::filesystem::temp_directory_path(error);
+				if (error)
+					return;
+
+				// other servers on the host may be benchmarking the same map
+				const auto Name = std::format("navbench-{:08x}-{}", std::random_device{}(), std::filesystem::path(navPath).filename().string());
+				m_path = (Directory / Name).string();
+				if (!std::filesystem::copy_file(navPath, m_path, std::filesystem::copy_options::overwrite_existing, error))
+					m_path.clear();
+			}
+			ScratchNavFile(const ScratchNavFile&) = delete;
+			ScratchNavFile& operator=(const ScratchNavFile&) = delete;
+
+			~ScratchNavFile() {
+				if (!m_path.empty())
+					RemoveNavFiles(m_path);
+			}
+
+			/// the copy, empty if it could not be made
+			const std::string& GetPath() const noexcept { return m_path; }
+
+		private:
+			std::string m_path{};
+		};
+
+		/// a map that loads from a ScratchNavFile without building the ladders of the level
+		std::unique_ptr<NavigationMap> MakeScratchMap() {
+			auto map = std::make_unique<NavigationMap>();
+			map->SetLadderBuilding(false);
+			return map;
+		}
+
+		/**
+		 * Build a corridor of the given length by walking randomly over the walkable links.
+		 * Areas may repeat, which is fine for benchmarking since every step is still between adjacent areas.
+		 */
+		bool RandomCorridor(const NavigationMap& map, std::mt19937* random, std::uint32_t length, std::vector<std::uint32_t>* corridor) {
+			corridor->clear();
+			std::uint32_t area = (*random)() % map.GetAreaCount();
+			corridor->push_back(area);
+
+			std::vector<std::uint32_t> choices;
+			while (corridor->size() < length) {
+				const std::uint32_t previous = corridor->size() > 1 ? (*corridor)[corridor->size() - 2] : Invalid_Index;
+
+				// avoid stepping straight back unless it is the only way out
+				choices.clear();
+				for (auto& link : map.GetOutgoingLinks(area)) {
+					if (link.how < GO_LADDER_UP && link.to != previous)
+						choices.push_back(link.to);
+				}
+				if (choices.empty() && previous != Invalid_Index)
+					choices.push_back(previous);
+
+				if (choices.empty())
+					return false;
+
+				area = choices[(*random)() % choices.size()];
+				corridor->push_back(area);
+			}
+			return true;
+		}
+	}
+
+	void BenchmarkPathSmoothing(const NavigationMap& map, std::string* report) {
+		if (map.GetAreaCount() == 0) {
+			*report += "No navigation map is loaded.\n";
+			return;
+		}
+
+		constexpr std::uint32_t Corridor_Count = 200;
+		std::mt19937 random(1);
+
+		for (std::uint32_t length : { 10u, 100u, 1000u }) {
+			// generate every corridor up front so only the smoothing is timed
+			std::vector<std::vector<std::uint32_t>> corridors;
+			std::vector<std::uint32_t> corridor;
+			for (std::uint32_t attempt = 0; corridors.size() < Corridor_Count && attempt < 10 * Corridor_Count; ++attempt) {
+				if (RandomCorridor(map, &random, length, &corridor))
+					corridors.push_back(corridor);
+			}
+
+			if (corridors.empty()) {
+				*report += std::format("funnel {:>4} areas: could not build a corridor\n", length);
+				continue;
+			}
+
+			std::vector<Vector> waypoints(2 * length + 2);
+			std::size_t totalWaypoints = 0;
+
+			const auto Start = Clock::now();
+			for (auto& path : corridors) {
+				const Vector From = map.GetAreaByIndex(path.front())->m_center;
+				const Vector To = map.GetAreaByIndex(path.back())->m_center;
+				totalWaypoints += SmoothPath(map, path, From, To, waypoints);
+			}
+			const std::chrono::duration<double, std::micro> Elapsed = Clock::now() - Start;
+
+			*report += std::format("funnel {:>4} areas: {:.2f} us per corridor, {:.1f} waypoints on average ({} corridors)\n",
+				length, Elapsed.count() / corridors.size(), static_cast<double>(totalWaypoints) / corridors.size(), corridors.size());
+		}
+	}
+
+	/**
+	 * Walk agents along random routes while shoving them into neighboring areas, as happens in a crowd,
+	 * and count how often a full replan is needed with and without corridor repair.
+	 */
+	void BenchmarkCorridorRepair(const NavigationMap& map, std::string* report) {
+		if (map.GetAreaCount() == 0) {
+			*report += "No navigation map is loaded.\n";
+			return;
+		}
+
+		constexpr std::uint32_t Route_Count = 200;
+		std::mt19937 random(1);
+		PathSearch search;
+		const NavSnapshot Snapshot(&map);						// the map cannot change while the benchmark runs
+		PathCorridor corridor;
+		std::vector<std::uint32_t> path;
+
+		for (std::uint32_t pushPercent : { 10u, 30u, 50u }) {
+			std::uint32_t steps = 0, naiveReplans = 0, corridorReplans = 0;
+
+			for (std::uint32_t route = 0; route < Route_Count; ++route) {
+				if (!search.Find(map, random() % map.GetAreaCount(), random() % map.GetAreaCount(), &path) || path.size() < 2)
+					continue;
+
+				corridor.Reset(Snapshot, path);
+				const std::uint32_t goal = path.back();
+
+				for (std::uint32_t step = 0; step < 4 * path.size() && corridor.GetCurrentArea() != goal; ++step) {
+					++steps;
+
+					// either follow the corridor, or get pushed into a random neighbor
+					const auto Remaining = corridor.GetRemaining();
+					std::uint32_t area = Remaining.size() > 1 ? Remaining[1] : Remaining[0];
+					if (random() % 100 < pushPercent) {
+						const auto Links = map.GetOutgoingLinks(corridor.GetCurrentArea());
+						if (!Links.empty())
+							area = Links[random() % Links.size()].to;
+					}
+
+					// without a corridor, anything but the next area on the route means searching again
+					if (Remaining.size() < 2 || area != Remaining[1])
+						++naiveReplans;
+
+					const Vector Pos = map.GetAreaByIndex(area)->m_center;
+					if (corridor.Update(Snapshot, Pos) == PathCorridor::NEEDS_REPLAN) {
+						++corridorReplans;
+						if (!search.Find(map, area, goal, &path))
+							break;
+						corridor.Reset(Snapshot, path);
+					}
+				}
+			}
+
+			*report += std::format("corridor, {:>2}% pushed: {} steps, {} replans without repair, {} with repair\n",
+				pushPercent, steps, naiveReplans, corridorReplans);
+		}
+	}
+
+	/**
+	 * Plan random routes with D* Lite, block an area on each planned path, as a closing door would, and compare
+	 * repairing the search with planning again from scratch. Routes are grouped by where on the path the area is
+	 * blocked, since a repair only pays off when the change is far from the goal the search grew from.
+	 */
+	void BenchmarkIncrementalRepair(const NavigationMap& map, std::string* report) {
+		if (map.GetAreaCount() == 0) {
+			*report += "No navigation map is loaded.\n";
+			return;
+		}
+
+		struct Bucket {
+			const char* name;
+			float along;										///< where the blocked area is on the path, from the agent to the goal
+			std::uint32_t routes;
+			std::uint64_t expanded[2];
+			double microseconds[2];
+		};
+
+		constexpr std::uint32_t Route_Count = 200;
+		std::mt19937 random(1);
+		const NavSnapshot Snapshot(&map);						// the map cannot change while the benchmark runs
+
+		// blocked here rather than in the game's AreaBlocking, so the bots playing are not affected
+		AreaBlocking blocking;
+		blocking.Reset(map.GetAreaCount());
+		IncrementalPathPlanner repaired(&blocking), replanned(&blocking);
+		std::vector<std::uint32_t> path;
+		Bucket buckets[] = {
+			{ "near the agent", 0.25f },
+			{ "halfway", 0.5f },
+			{ "near the goal", 0.75f },
+		};
+		std::uint32_t mismatches = 0;
+
+		for (auto& bucket : buckets) {
+			for (std::uint32_t route = 0; route < Route_Count; ++route) {
+				const std::uint32_t From = random() % map.GetAreaCount();
+				const std::uint32_t To = random() % map.GetAreaCount();
+				if (!repaired.Plan(Snapshot, From, To) || !repaired.GetPath(Snapshot, &path) || path.size() < 3)
+					continue;
+
+				// never the agent's area or the goal
+				const auto Blocked_At = std::clamp<std::size_t>(static_cast<std::size_t>(bucket.along * path.size()), 1, path.size() - 2);
+				const std::uint32_t Blocked = path[Blocked_At];
+				blocking.SetAreaEnabled(Blocked, false);
+
+				auto start = Clock::now();
+				const bool Repaired = repaired.Replan(Snapshot, From);
+				const std::chrono::duration<double, std::micro> Repair_Elapsed = Clock::now() - start;
+				const std::uint32_t Repair_Expanded = repaired.GetLastExpandedCount();
+
+				start = Clock::now();
+				const bool Replanned = replanned.Plan(Snapshot, From, To);
+				const std::chrono::duration<double, std::micro> Replan_Elapsed = Clock::now() - start;
+
+				blocking.SetAreaEnabled(Blocked, true);
+				if (Repaired != Replanned) {
+					++mismatches;
+					continue;
+				}
+
+				bucket.routes++;
+				bucket.expanded[0] += Repair_Expanded;
+				bucket.expanded[1] += replanned.GetLastExpandedCount();
+				bucket.microseconds[0] += Repair_Elapsed.count();
+				bucket.microseconds[1] += Replan_Elapsed.count();
+			}
+		}
+
+		for (auto& bucket : buckets) {
+			if (bucket.routes == 0)
+				continue;
+
+			*report += std::format("incremental, blocked {:<14} repair {:.1f} expanded {:.2f} us, full replan {:.1f} expanded {:.2f} us ({} routes)\n",
+				bucket.name,
+				static_cast<double>(bucket.expanded[0]) / bucket.routes, bucket.microseconds[0] / bucket.routes,
+				static_cast<double>(bucket.expanded[1]) / bucket.routes, bucket.microseconds[1] / bucket.routes,
+				bucket.routes);
+		}
+
+		if (mismatches > 0)
+			*report += std::format("incremental: {} routes disagreed between repair and full replan\n", mismatches);
+	}
+
+	/**
+	 * Search the same random routes with plain and bidirectional A*, and compare the work done.
+	 * Routes are grouped by length since the bidirectional search only pays off on long ones.
+	 */
+	void BenchmarkBidirectionalSearch(const NavigationMap& map, std::string* report) {
+		if (map.GetAreaCount() == 0) {
+			*report += "No navigation map is loaded.\n";
+			return;
+		}
+
+		struct Bucket {
+			std::uint32_t routes;
+			std::uint64_t expanded[2];
+			double microseconds[2];
+		};
+
+		constexpr std::uint32_t Route_Count = 500;
+		constexpr std::uint32_t Bucket_Limits[] = { 10, 50, 200 };		///< upper bound on the route length of each bucket but the last
+		std::mt19937 random(1);
+		PathSearch search;
+		std::vector<std::uint32_t> path, bidirectionalPath;
+		Bucket buckets[std::size(Bucket_Limits) + 1]{};
+		std::uint32_t mismatches = 0;
+
+		for (std::uint32_t route = 0; route < Route_Count; ++route) {
+			const std::uint32_t From = random() % map.GetAreaCount();
+			const std::uint32_t To = random() % map.GetAreaCount();
+
+			auto start = Clock::now();
+			const bool Found = search.Find(map, From, To, &path);
+			const std::chrono::duration<double, std::micro> Elapsed = Clock::now() - start;
+			const std::uint32_t Expanded = search.GetExpandedCount();
+
+			start = Clock::now();
+			const bool FoundBidirectional = search.FindBidirectional(map, From, To, &bidirectionalPath);
+			const std::chrono::duration<double, std::micro> ElapsedBidirectional = Clock::now() - start;
+
+			if (Found != FoundBidirectional) {
+				++mismatches;
+				continue;
+			}
+
+			if (!Found)
+				continue;
+
+			// both must be optimal, though ties may be broken differently
+			auto pathCost = [&](const std::vector<std::uint32_t>& areas) {
+				float cost = 0.0f;
+				for (std::size_t i = 1; i < areas.size(); ++i)
+					cost += map.GetLinkCost(map.GetLink(map.FindLink(areas[i - 1], areas[i])));
+				return cost;
+			};
+			if (std::fabs(pathCost(path) - pathCost(bidirectionalPath)) > 0.01f * (1.0f + pathCost(path)))
+				++mismatches;
+
+			std::size_t bucket = 0;
+			while (bucket < std::size(Bucket_Limits) && path.size() > Bucket_Limits[bucket])
+				++bucket;
+
+			buckets[bucket].routes++;
+			buckets[bucket].expanded[0] += Expanded;
+			buckets[bucket].expanded[1] += search.GetExpandedCount();
+			buckets[bucket].microseconds[0] += Elapsed.count();
+			buckets[bucket].microseconds[1] += ElapsedBidirectional.count();
+		}
+
+		for (std::size_t i = 0; i < std::size(buckets); ++i) {
+			const Bucket& bucket = buckets[i];
+			if (bucket.routes == 0)
+				continue;
+
+			const std::string Range = (i < std::size(Bucket_Limits)) ? std::format("<= {}", Bucket_Limits[i]) : std::format("> {}", Bucket_Limits[i - 1]);
+			*report += std::format("search, routes {:>6} areas: A* {:.1f} expanded {:.2f} us, bidirectional {:.1f} expanded {:.2f} us ({} routes)\n",
+				Range,
+				static_cast<double>(bucket.expanded[0]) / bucket.routes, bucket.microseconds[0] / bucket.routes,
+				static_cast<double>(bucket.expanded[1]) / bucket.routes, bucket.microseconds[1] / bucket.routes,
+				bucket.routes);
+		}
+
+		if (mismatches > 0)
+			*report += std::format("search: {} routes disagreed between A* and bidirectional search\n", mismatches);
+	}
+
+	/**
+	 * Report what the potentially visible sets cost, and how many line of sight checks between random areas
+	 * they would answer without a trace with visibility culling. Also report the checks culled since the map was loaded.
+	 */
+	void BenchmarkVisibility(const NavigationMap& map, std::string* report) {
+		if (map.GetAreaCount() == 0) {
+			*report += "No navigation map is loaded.\n";
+			return;
+		}
+
+		const auto& Stats = map.GetVisibility().GetStats();
+		const double Area_Count = map.GetAreaCount();
+		*report += std::format("visibility: built in {:.2f} ms, {} bytes, {:.1f} visible areas per area\n",
+			Stats.buildMilliseconds, Stats.memoryBytes, Stats.visiblePairs / Area_Count);
+
+		constexpr std::uint32_t Query_Count = 100000;
+		std::mt19937 random(1);
+		std::uint32_t rejected = 0;
+
+		const auto Start = Clock::now();
+		for (std::uint32_t i = 0; i < Query_Count; ++i) {
+			if (!map.IsPotentiallyVisible(random() % map.GetAreaCount(), random() % map.GetAreaCount()))
+				++rejected;
+		}
+		const std::chrono::duration<double, std::nano> Elapsed = Clock::now() - Start;
+
+		*report += std::format("visibility: {:.1f}% of random area pairs would skip the trace, {:.1f} ns per query\n",
+			100.0 * rejected / Query_Count, Elapsed.count() / Query_Count);
+
+		if (Stats.queries > 0) {
+			*report += std::format("visibility: {} of {} line of sight checks since loading were answered without a trace ({:.1f}%)\n",
+				Stats.rejected, Stats.queries, 100.0 * Stats.rejected / Stats.queries);
+		}
+	}
+
+	/**
+	 * Compare the mesh-only walkability test against the engine trace it replaces, over random short lines
+	 * starting at area centers.
+	 */
+	void BenchmarkWalkableLine(const NavigationMap& map, std::string* report) {
+		if (map.GetAreaCount() == 0) {
+			*report += "No navigation map is loaded.\n";
+			return;
+		}
+
+		constexpr std::uint32_t Line_Count = 2000;
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> angle(0.0f, 2.0f * std::numbers::pi_v<float>);
+		std::uniform_real_distribution<float> length(100.0f, 800.0f);
+
+		std::vector<Ray> lines(Line_Count);
+		for (auto& line : lines) {
+			line.from = map.GetAreaByIndex(random() % map.GetAreaCount())->m_center;
+			const float Angle = angle(random), Length = length(random);
+			line.to = line.from + Vector(std::cos(Angle) * Length, std::sin(Angle) * Length, 0.0f);
+		}
+
+		std::vector<bool> walkable(Line_Count);
+		auto start = Clock::now();
+		for (std::uint32_t i = 0; i < Line_Count; ++i)
+			walkable[i] = map.IsWalkableLine(lines[i].from, lines[i].to);
+		const std::chrono::duration<double, std::micro> Mesh_Elapsed = Clock::now() - start;
+
+		// the engine check this replaces: a trace at knee height
+		std::uint32_t agreed = 0, walkableCount = 0;
+		start = Clock::now();
+		for (std::uint32_t i = 0; i < Line_Count; ++i) {
+			TraceResult result;
+			UTIL_TraceLine(lines[i].from + Vector(0, 0, StepHeight), lines[i].to + Vector(0, 0, StepHeight), ignore_monsters, nullptr, &result);
+			if ((result.flFraction >= 1.0f) == walkable[i])
+				++agreed;
+		}
+		const std::chrono::duration<double, std::micro> Trace_Elapsed = Clock::now() - start;
+
+		for (bool clear : walkable)
+			walkableCount += clear;
+
+		*report += std::format("walkable line: mesh {:.2f} us, trace {:.2f} us per line, {:.1f}% walkable, {:.1f}% agree with the trace\n",
+			Mesh_Elapsed.count() / Line_Count, Trace_Elapsed.count() / Line_Count, 100.0 * walkableCount / Line_Count, 100.0 * agreed / Line_Count);
+	}
+
+	/**
+	 * Load a scratch copy of the map twice, with and without a shared image, and report the resident memory each
+	 * load adds. Every server process holds the private part of a load, while the pages of the image are resident
+	 * once for the whole host; the totals for several processes are extrapolated from that.
+	 */
+	void BenchmarkSharedImage(const NavigationMap& map, std::string* report) {
+		if (map.GetAreaCount() == 0) {
+			*report += "No navigation map is loaded.\n";
+			return;
+		}
+
+		const ScratchNavFile Scratch(map.GetPath());
+		if (Scratch.GetPath().empty()) {
+			*report += "shared image: the map could not be copied to the temporary directory\n";
+			return;
+		}
+
+		// both copies stay loaded until the end, so neither reuses memory freed by the other
+		std::int64_t before = GetResidentBytes();
+		auto shared = MakeScratchMap();
+		if (!shared->Load(Scratch.GetPath()) || shared->GetImage() == nullptr) {
+			*report += "shared image: the image could not be written or mapped\n";
+			return;
+		}
+
+		// fault in every page of the image, as queries eventually do
+		const auto Image = shared->GetImage()->GetBytes();
+		volatile std::uint8_t sink = 0;
+		for (std::size_t i = 0; i < Image.size(); i += 4096)
+			sink = sink + Image[i];
+		const std::int64_t Shared_Load = GetResidentBytes() - before;
+		const auto Image_Bytes = static_cast<std::int64_t>(Image.size());
+
+		before = GetResidentBytes();
+		auto copy = MakeScratchMap();
+		copy->SetImageSharing(false);
+		copy->Load(Scratch.GetPath());
+		const std::int64_t Private_Load = GetResidentBytes() - before;
+
+		const std::int64_t Private_Part = (std::max)(Shared_Load - Image_Bytes, std::int64_t{ 0 });
+		*report += std::format("shared image: {} KB, private load +{} KB resident, shared load +{} KB resident ({} KB of it the image)\n",
+			Image_Bytes / 1024, Private_Load / 1024, Shared_Load / 1024, Image_Bytes / 1024);
+
+		for (int processes : { 1, 4, 12 }) {
+			*report += std::format("shared image: {} processes, {} KB resident without sharing, {} KB with\n",
+				processes, processes * Private_Load / 1024, (Image_Bytes + processes * Private_Part) / 1024);
+		}
+	}
+
+	/**
+	 * Load a scratch copy of the map in each area order, and time the same grid queries and path searches on
+	 * every copy. The last copy is saved in Hilbert order and loaded back in file order, so its areas are also
+	 * allocated in that order. Link spread is the mean distance between the indices of linked areas; the lower it is, the
+	 * closer together the entries a search reads.
+	 */
+	void BenchmarkAreaOrder(const NavigationMap& map, std::string* report) {
+		if (map.GetAreaCount() == 0) {
+			*report += "No navigation map is loaded.\n";
+			return;
+		}
+
+		// the same positions and routes for every copy; routes go by area ID, since the indices differ
+		constexpr std::uint32_t Query_Count = 100000;
+		constexpr std::uint32_t Route_Count = 500;
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<Vector> positions(Query_Count);
+		for (auto& pos : positions) {
+			const NavArea* area = map.GetAreaByIndex(random() % map.GetAreaCount());
+			pos.x = area->m_extent.lo.x + unit(random) * (area->m_extent.hi.x - area->m_extent.lo.x);
+			pos.y = area->m_extent.lo.y + unit(random) * (area->m_extent.hi.y - area->m_extent.lo.y);
+			pos.z = area->GetZ(&pos) + HalfHumanHeight;
+		}
+
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> routes(Route_Count);
+		for (auto& route : routes)
+			route = { map.GetAreaByIndex(random() % map.GetAreaCount())->m_id, map.GetAreaByIndex(random() % map.GetAreaCount())->m_id };
+
+		const ScratchNavFile Scratch(map.GetPath());
+		if (Scratch.GetPath().empty()) {
+			*report += "area order: the map could not be copied to the temporary directory\n";
+			return;
+		}
+
+		const std::string Saved_Path = Scratch.GetPath() + ".ordered.nav";
+		struct Variant {
+			const char* name;
+			NavAreaOrderType order;
+			const std::string* path;
+		};
+		const Variant Variants[] = {
+			{ "file", FILE_AREA_ORDER, &Scratch.GetPath() },
+			{ "bfs", BFS_AREA_ORDER, &Scratch.GetPath() },
+			{ "hilbert", HILBERT_AREA_ORDER, &Scratch.GetPath() },
+			{ "hilbert, saved", FILE_AREA_ORDER, &Saved_Path },
+		};
+
+		PathSearch search;
+		std::vector<std::uint32_t> path;
+		for (auto& variant : Variants) {
+			auto copy = MakeScratchMap();
+			copy->SetImageSharing(false);
+			copy->SetAreaOrder(variant.order);
+			if (!copy->Load(*variant.path)) {
+				*report += std::format("area order: {} could not be loaded\n", variant.name);
+				continue;
+			}
+
+			if (variant.order == HILBERT_AREA_ORDER && !copy->Save(Saved_Path))
+				*report += std::format("area order: could not write {}\n", Saved_Path);
+
+			double spread = 0.0;
+			std::uint64_t linkCount = 0;
+			for (std::uint32_t i = 0; i < copy->GetAreaCount(); ++i) {
+				for (auto& link : copy->GetOutgoingLinks(i)) {
+					spread += std::fabs(static_cast<double>(link.to) - i);
+					++linkCount;
+				}
+			}
+
+			std::uint32_t found = 0;
+			auto start = Clock::now();
+			for (auto& pos : positions) {
+				if (copy->GetNavArea(&pos) != nullptr)
+					++found;
+			}
+			const std::chrono::duration<double, std::nano> Query_Elapsed = Clock::now() - start;
+
+			std::uint64_t pathAreas = 0;
+			start = Clock::now();
+			for (auto& route : routes) {
+				const NavArea* from = copy->GetNavAreaByID(route.first);
+				const NavArea* to = copy->GetNavAreaByID(route.second);
+				if (from != nullptr && to != nullptr && search.Find(*copy, from->m_index, to->m_index, &path))
+					pathAreas += path.size();
+			}
+			const std::chrono::duration<double, std::micro> Search_Elapsed = Clock::now() - start;
+
+			*report += std::format("area order: {:<14} link spread {:>8.1f}, grid query {:.1f} ns ({} found), path search {:.2f} us ({} areas)\n",
+				variant.name, linkCount > 0 ? spread / linkCount : 0.0, Query_Elapsed.count() / Query_Count, found,
+				Search_Elapsed.count() / Route_Count, pathAreas);
+		}
+
+		RemoveNavFiles(Saved_Path);
+	}
+
+	void BenchmarkMergedAreas(const NavigationMap& map, std::string* report) {
+		if (map.GetAreaCount() == 0) {
+			*report += "No navigation map is loaded.\n";
+			return;
+		}
+
+		const ScratchNavFile Scratch(map.GetPath());
+		if (Scratch.GetPath().empty()) {
+			*report += "merged areas: the map could not be copied to the temporary directory\n";
+			return;
+		}
+
+		// merge a copy of the mesh and load it back the way a server would, but without its ladders
+		const std::string Merged_Path = Scratch.GetPath() + ".merged.nav";
+		auto copy = std::make_unique<NavigationMap>();
+		if (!copy->LoadMesh(Scratch.GetPath())) {
+			*report += "merged areas: the mesh could not be read\n";
+			return;
+		}
+
+		const std::uint32_t Merged = copy->MergeAreas();
+		auto merged = MakeScratchMap();
+		merged->SetImageSharing(false);
+		if (!copy->Save(Merged_Path) || !merged->Load(Merged_Path)) {
+			*report += std::format("merged areas: could not write and load {}\n", Merged_Path);
+			RemoveNavFiles(Merged_Path);
+			return;
+		}
+		copy.reset();
+
+		// the same routes on both, by the IDs of the original areas, which the merged map still resolves
+		constexpr std::uint32_t Route_Count = 500;
+		std::mt19937 random(1);
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> routes(Route_Count);
+		for (auto& route : routes)
+			route = { map.GetAreaByIndex(random() % map.GetAreaCount())->m_id, map.GetAreaByIndex(random() % map.GetAreaCount())->m_id };
+
+		PathSearch search;
+		std::vector<std::uint32_t> path;
+		for (const NavigationMap* variant : { &map, static_cast<const NavigationMap*>(merged.get()) }) {
+			std::uint32_t found = 0;
+			std::uint64_t expanded = 0;
+			auto start = Clock::now();
+			for (auto& route : routes) {
+				const NavArea* from = variant->GetNavAreaByID(route.first);
+				const NavArea* to = variant->GetNavAreaByID(route.second);
+				if (from != nullptr && to != nullptr && search.Find(*variant, from->m_index, to->m_index, &path))
+					++found;
+				expanded += search.GetExpandedCount();
+			}
+			const std::chrono::duration<double, std::micro> Elapsed = Clock::now() - start;
+
+			*report += std::format("merged areas: {:<8} {:>6} areas, path search {:.2f} us, {:.1f} areas expanded ({} of {} found)\n",
+				variant == &map ? "original" : "merged", variant->GetAreaCount(), Elapsed.count() / Route_Count,
+				static_cast<double>(expanded) / Route_Count, found, Route_Count);
+		}
+		*report += std::format("merged areas: {} areas merged into others\n", Merged);
+
+		merged.reset();
+		RemoveNavFiles(Merged_Path);
+	}
+
+	/**
+	 * Report how many ground traces the ground height cache saved the off-mesh queries made since loading.
+	 */
+	void BenchmarkGroundHeight(const NavigationMap& map, std::string* report) {
+		const auto& Cache = map.GetGroundHeightCache();
+		const auto& Stats = Cache.GetStats();
+		if (Stats.lookups == 0) {
+			*report += "ground height: no queries since loading\n";
+			return;
+		}
+
+		*report += std::format("ground height: {} columns, {} of {} lookups hit ({:.1f}%), {} traces made, {} traces saved\n",
+			Cache.GetColumnCount(), Stats.hits, Stats.lookups, 100.0 * Stats.hits / Stats.lookups, Stats.tracesMade, Stats.tracesSaved);
+	}
+
+	/**
+	 * Load a scratch copy of the map with and without lazy decoding, both from a shared image, then ask every area
+	 * for its hiding spots and encounters, as a consumer that reads them all would.
+	 */
+	void BenchmarkLazyDecoding(const NavigationMap& map, std::string* report) {
+		if (map.GetAreaCount() == 0) {
+			*report += "No navigation map is loaded.\n";
+			return;
+		}
+
+		// write the image of the copy first, so both loads below map it, as every server after the first does
+		const ScratchNavFile Scratch(map.GetPath());
+		if (Scratch.GetPath().empty() || !MakeScratchMap()->Load(Scratch.GetPath())) {
+			*report += "lazy decoding: the map could not be copied to the temporary directory and loaded\n";
+			return;
+		}
+
+		// both copies stay loaded until the end, so neither reuses memory freed by the other
+		std::unique_ptr<NavigationMap> copies[2];
+		for (bool lazy : { false, true }) {
+			const std::int64_t Before = GetResidentBytes();
+			auto start = Clock::now();
+			auto& copy = copies[lazy];
+			copy = MakeScratchMap();
+			copy->SetLazyDecoding(lazy);
+			if (!copy->Load(Scratch.GetPath())) {
+				*report += "lazy decoding: the map could not be loaded\n";
+				return;
+			}
+			const std::chrono::duration<double, std::milli> Load_Elapsed = Clock::now() - start;
+			const std::int64_t Load_Resident = GetResidentBytes() - Before;
+			const std::size_t Load_Bytes = copy->GetMemoryUsage();
+
+			start = Clock::now();
+			std::size_t encounters = 0;
+			for (std::uint32_t i = 0; i < copy->GetAreaCount(); ++i) {
+				const NavArea* area = copy->GetAreaByIndex(i);
+				encounters += copy->GetSpotEncounters(area).size();
+				copy->GetHidingSpots(area);
+			}
+			const std::uint32_t Spots = copy->GetHidingSpotIndex().GetSpotCount();
+			const std::chrono::duration<double, std::milli> Access_Elapsed = Clock::now() - start;
+
+			*report += std::format("lazy decoding: {:<5} load {:.2f} ms, +{} KB resident, {} KB counted; then reading {} encounters and {} spots {:.2f} ms, {} KB counted{}\n",
+				lazy ? "lazy" : "eager", Load_Elapsed.count(), Load_Resident / 1024, Load_Bytes / 1024, encounters, Spots,
+				Access_Elapsed.count(), copy->GetMemoryUsage() / 1024, copy->GetImage() != nullptr ? "" : " (no image, so decoded while loading)");
+		}
+	}
+
+	void BenchmarkPlaceIndex(const NavigationMap& map, std::string* report) {
+		if (map.GetAreaCount() == 0) {
+			*report += "No navigation map is loaded.\n";
+			return;
+		}
+
+		// points off the mesh, above and beside random areas, where GetPlace() has to look for the closest area
+		constexpr std::uint32_t Query_Count = 2000;
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> offset(-300.0f, 300.0f);
+		std::vector<Vector> positions(Query_Count);
+		for (auto& pos : positions) {
+			const NavArea* area = map.GetAreaByIndex(random() % map.GetAreaCount());
+			pos = area->m_center + Vector(offset(random), offset(random), 100.0f + offset(random));
+		}
+
+		auto start = Clock::now();
+		std::vector<Place> places(Query_Count);
+		for (std::uint32_t i = 0; i < Query_Count; ++i)
+			places[i] = map.GetPlace(&positions[i]);
+		const std::chrono::duration<double, std::micro> Index_Elapsed = Clock::now() - start;
+
+		// what finding the closest area costs by visiting every area, without the traces that used to come with it
+		std::uint32_t agree = 0;
+		start = Clock::now();
+		for (std::uint32_t i = 0; i < Query_Count; ++i) {
+			const NavArea* close = map.GetNavArea(&positions[i]);
+			float closeDistSq = std::numeric_limits<float>::infinity();
+			if (close == nullptr) {
+				map.ForEachArea([&](const NavArea* area) {
+					Vector areaPos;
+					area->GetClosestPointOnArea(&positions[i], &areaPos);
+					const Vector Delta = areaPos - positions[i];
+					if (DotProduct(Delta, Delta) < closeDistSq) {
+						closeDistSq = DotProduct(Delta, Delta);
+						close = area;
+					}
+				});
+			}
+			agree += close != nullptr && close->m_place == places[i];
+		}
+		const std::chrono::duration<double, std::micro> Sweep_Elapsed = Clock::now() - start;
+
+		*report += std::format("place index: GetPlace off the mesh {:.2f} us, sweeping every area {:.2f} us, same place {}/{}\n",
+			Index_Elapsed.count() / Query_Count, Sweep_Elapsed.count() / Query_Count, agree, Query_Count);
+
+		// gathering the areas of every place
+		const PlaceIndex& Index = map.GetPlaceIndex();
+		std::size_t indexed = 0;
+		start = Clock::now();
+		for (const Place Place_Number : Index.GetPlaces())
+			indexed += Index.GetAreas(Place_Number).size();
+		const std::chrono::duration<double, std::micro> Lookup_Elapsed = Clock::now() - start;
+
+		std::size_t swept = 0;
+		start = Clock::now();
+		for (const Place Place_Number : Index.GetPlaces())
+			map.ForEachArea([&](const NavArea* area) { swept += area->m_place == Place_Number; });
+		const std::chrono::duration<double, std::micro> Place_Sweep_Elapsed = Clock::now() - start;
+
+		std::size_t borders = 0;
+		for (const Place Place_Number : Index.GetPlaces())
+			borders += Index.GetNeighbors(Place_Number).size();
+
+		*report += std::format("place index: {} places, {} borders, {} KB; areas of every place {:.2f} us from the index ({} areas), {:.2f} us sweeping ({} areas)\n",
+			Index.GetPlaces().size(), borders / 2, Index.GetMemoryUsage() / 1024, Lookup_Elapsed.count(), indexed, Place_Sweep_Elapsed.count(), swept);
+	}
+}
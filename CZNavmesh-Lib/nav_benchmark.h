@@ -0,0 +1,23 @@
+#pragma once
+#include "navigation_map.h"
+
+#include <string>
+
+namespace navmesh {
+	/**
+	 * Micro benchmarks that run against the currently loaded map.
+	 * Each one appends a human readable report to 'report'.
+	 */
+	void BenchmarkPathSmoothing(const NavigationMap& map, std::string* report);
+	void BenchmarkCorridorRepair(const NavigationMap& map, std::string* report);
+	void BenchmarkIncrementalRepair(const NavigationMap& map, std::string* report);
+	void BenchmarkBidirectionalSearch(const NavigationMap& map, std::string* report);
+	void BenchmarkVisibility(const NavigationMap& map, std::string* report);
+	void BenchmarkWalkableLine(const NavigationMap& map, std::string* report);
+	void BenchmarkGroundHeight(const NavigationMap& map, std::string* report);
+	void BenchmarkSharedImage(const NavigationMap& map, std::string* report);
+	void BenchmarkAreaOrder(const NavigationMap& map, std::string* report);
+	void BenchmarkMergedAreas(const NavigationMap& map, std::string* report);
+	void BenchmarkLazyDecoding(const NavigationMap& map, std::string* report);
+	void BenchmarkPlaceIndex(const NavigationMap& map, std::string* report);
+}
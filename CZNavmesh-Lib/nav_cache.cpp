@@ -0,0 +1,100 @@
+#include "nav_cache.h"
+
+#include <cstdio>
+
+namespace navmesh {
+	namespace {
+		struct CacheHeader {
+			std::uint32_t magic;
+			std::uint32_t version;
+			std::uint64_t fingerprint;
+			std::uint32_t sectionCount;
+		};
+
+		struct SectionHeader {
+			std::uint32_t tag;
+			std::uint32_t size;
+		};
+	}
+
+	bool NavCache::Read() {
+		m_sections.clear();
+
+		FILE* fp = fopen(m_path.c_str(), "rb");
+		if (fp == nullptr)
+			return false;
+
+		CacheHeader header{};
+		bool ok = fread(&header, sizeof header, 1, fp) == 1 && header.magic == Magic && header.version == Version && header.fingerprint == m_fingerprint;
+
+		for (std::uint32_t i = 0; ok && i < header.sectionCount; ++i) {
+			SectionHeader section{};
+			if (fread(&section, sizeof section, 1, fp) != 1) {
+				ok = false;
+				break;
+			}
+
+			std::vector<std::uint8_t> data(section.size);
+			if (section.size > 0 && fread(data.data(), section.size, 1, fp) != 1) {
+				ok = false;
+				break;
+			}
+			m_sections[section.tag] = std::move(data);
+		}
+		fclose(fp);
+
+		// a stale or truncated cache is as good as none
+		if (!ok)
+			m_sections.clear();
+
+		return ok;
+	}
+
+	bool NavCache::Write() const {
+		FILE* fp = fopen(m_path.c_str(), "wb");
+		if (fp == nullptr)
+			return false;
+
+		const CacheHeader Header{ Magic, Version, m_fingerprint, static_cast<std::uint32_t>(m_sections.size()) };
+		bool ok = fwrite(&Header, sizeof Header, 1, fp) == 1;
+
+		for (auto& [tag, data] : m_sections) {
+			const SectionHeader Section{ tag, static_cast<std::uint32_t>(data.size()) };
+			ok = ok && fwrite(&Section, sizeof Section, 1, fp) == 1;
+			ok = ok && (data.empty() || fwrite(data.data(), data.size(), 1, fp) == 1);
+		}
+		fclose(fp);
+		return ok;
+	}
+
+	const std::vector<std::uint8_t>* NavCache::GetSection(SectionTag tag) const {
+		auto section = m_sections.find(tag);
+		return (section != m_sections.end()) ? &section->second : nullptr;
+	}
+
+	std::uint64_t FingerprintFile(const std::string& path) {
+		FILE* fp = fopen(path.c_str(), "rb");
+		if (fp == nullptr)
+			return 0;
+
+		std::uint64_t hash = 0xCBF29CE484222325ull;
+		unsigned char buffer[4096];
+		for (std::size_t read; (read = fread(buffer, 1, sizeof buffer, fp)) > 0;) {
+			for (std::size_t i = 0; i < read; ++i) {
+				hash ^= buffer[i];
+				hash *= 0x100000001B3ull;
+			}
+		}
+		fclose(fp);
+		return hash;
+	}
+
+	std::uint64_t FingerprintData(const std::vector<std::uint8_t>& data) {
+		std::uint64_t hash = 0xCBF29CE484222325ull;
+		for (auto byte : data) {
+			hash ^= byte;
+			hash *= 0x100000001B3ull;
+		}
+		return hash;
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace navmesh {
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * The compiled nav cache is a file kept next to a .nav file, holding results that are expensive to compute
+	 * while loading, such as those needing engine traces.
+	 * It is made of tagged sections, and is only used with the .nav file whose fingerprint it was written with.
+	 */
+	class NavCache {
+	public:
+		enum SectionTag : std::uint32_t {
+			LADDER_SECTION = 0x5244414C,						///< 'LADR', see NavigationMap::BuildLadders()
+		};
+
+		NavCache(std::string path, std::uint64_t fingerprint) : m_path(std::move(path)), m_fingerprint(fingerprint) { }
+
+		/// return the cache file to use for the given .nav file
+		static std::string GetPathFor(const std::string& navPath) { return navPath + ".cache"; }
+
+		/// read the sections from disk, return false if there is no cache for this fingerprint
+		bool Read();
+
+		/// write every section to disk, replacing the file
+		bool Write() const;
+
+		const std::vector<std::uint8_t>* GetSection(SectionTag tag) const;
+		void SetSection(SectionTag tag, std::vector<std::uint8_t> data) { m_sections[tag] = std::move(data); }
+
+	private:
+		static constexpr std::uint32_t Magic = 0x434E5A43;		///< 'CZNC'
+		static constexpr std::uint32_t Version = 1;
+
+		std::string m_path;
+		std::uint64_t m_fingerprint;
+		std::map<std::uint32_t, std::vector<std::uint8_t>> m_sections{};
+	};
+
+	/// 64 bit FNV-1a hash of a file's contents, or zero if it cannot be read
+	std::uint64_t FingerprintFile(const std::string& path);
+
+	/// 64 bit FNV-1a hash of a block of memory
+	std::uint64_t FingerprintData(const std::vector<std::uint8_t>& data);
+}
@@ -0,0 +1,164 @@
+#include "nav_image.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <format>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace navmesh {
+	namespace {
+		struct ImageHeader {
+			std::uint32_t magic;
+			std::uint32_t version;
+			std::uint64_t fingerprint;
+			std::uint64_t levelKey;
+			std::uint32_t sectionCount;
+			std::uint32_t reserved;
+		};
+
+		struct SectionEntry {
+			std::uint32_t tag;
+			std::uint32_t elementSize;
+			std::uint64_t offset;								///< from the start of the file
+			std::uint64_t count;
+		};
+
+		/// map a whole file read-only, return nullptr if it cannot be
+		const void* MapFile(const std::string& path, std::size_t* size) {
+#ifdef _WIN32
+			HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return nullptr;
+
+			LARGE_INTEGER fileSize{};
+			const void* base = nullptr;
+			if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+				// the view keeps the mapping alive, so neither handle is needed past this point
+				if (HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr); mapping != nullptr) {
+					base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+					CloseHandle(mapping);
+				}
+			}
+			CloseHandle(file);
+			*size = static_cast<std::size_t>(fileSize.QuadPart);
+			return base;
+#else
+			const int File = open(path.c_str(), O_RDONLY);
+			if (File < 0)
+				return nullptr;
+
+			struct stat info{};
+			void* base = nullptr;
+			if (fstat(File, &info) == 0 && info.st_size > 0) {
+				base = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, File, 0);
+				if (base == MAP_FAILED)
+					base = nullptr;
+			}
+			close(File);
+			*size = static_cast<std::size_t>(info.st_size);
+			return base;
+#endif
+		}
+
+		void UnmapFile(const void* base, std::size_t size) {
+#ifdef _WIN32
+			UnmapViewOfFile(base);
+#else
+			munmap(const_cast<void*>(base), size);
+#endif
+		}
+
+		/// a name no other process writing the same image uses
+		std::string GetTemporaryPath(const std::string& path) {
+#ifdef _WIN32
+			return std::format("{}.{}.tmp", path, GetCurrentProcessId());
+#else
+			return std::format("{}.{}.tmp", path, getpid());
+#endif
+		}
+	}
+
+	NavImage::~NavImage() {
+		UnmapFile(m_base, m_size);
+	}
+
+	std::unique_ptr<NavImage> NavImage::Open(const std::string& path, std::uint64_t fingerprint, std::uint64_t levelKey) {
+		std::size_t size = 0;
+		const void* base = MapFile(path, &size);
+		if (base == nullptr)
+			return nullptr;
+
+		std::unique_ptr<NavImage> image(new NavImage(base, size));
+
+		// an image made for another file or level is as good as none
+		const auto Header = static_cast<const ImageHeader*>(base);
+		if (size < sizeof(ImageHeader) || Header->magic != Magic || Header->version != Version || Header->fingerprint != fingerprint || Header->levelKey != levelKey)
+			return nullptr;
+
+		if ((size - sizeof(ImageHeader)) / sizeof(SectionEntry) < Header->sectionCount)
+			return nullptr;
+
+		return image;
+	}
+
+	bool NavImage::Write(const std::string& path, std::uint64_t fingerprint, std::uint64_t levelKey, const std::vector<Section>& sections) {
+		const std::string Temporary_Path = GetTemporaryPath(path);
+		FILE* fp = fopen(Temporary_Path.c_str(), "wb");
+		if (fp == nullptr)
+			return false;
+
+		const ImageHeader Header{ Magic, Version, fingerprint, levelKey, static_cast<std::uint32_t>(sections.size()), 0 };
+		bool ok = fwrite(&Header, sizeof Header, 1, fp) == 1;
+
+		// the data of each section follows the section table, aligned for any element type
+		auto align = [](std::uint64_t offset) { return (offset + Section_Alignment - 1) & ~std::uint64_t{ Section_Alignment - 1 }; };
+		std::uint64_t offset = align(sizeof(ImageHeader) + sections.size() * sizeof(SectionEntry));
+		for (auto& section : sections) {
+			const SectionEntry Entry{ section.tag, section.elementSize, offset, section.count };
+			ok = ok && fwrite(&Entry, sizeof Entry, 1, fp) == 1;
+			offset = align(offset + section.count * section.elementSize);
+		}
+
+		static constexpr std::uint8_t Padding[Section_Alignment]{};
+		for (auto& section : sections) {
+			const auto Position = static_cast<std::uint64_t>(ftell(fp));
+			ok = ok && fwrite(Padding, 1, align(Position) - Position, fp) == align(Position) - Position;
+			ok = ok && (section.count == 0 || fwrite(section.data, section.elementSize, section.count, fp) == section.count);
+		}
+		ok = fclose(fp) == 0 && ok;
+
+		// a process that got there first may have the image mapped, so it cannot be replaced; theirs is as good
+		std::error_code error;
+		if (ok)
+			std::filesystem::rename(Temporary_Path, path, error);
+
+		std::filesystem::remove(Temporary_Path, error);
+		return ok;
+	}
+
+	bool NavImage::FindSection(SectionTag tag, std::uint32_t elementSize, const void** data, std::size_t* count) const {
+		const auto Header = static_cast<const ImageHeader*>(m_base);
+		const auto Entries = reinterpret_cast<const SectionEntry*>(Header + 1);
+		for (std::uint32_t i = 0; i < Header->sectionCount; ++i) {
+			const SectionEntry& entry = Entries[i];
+			if (entry.tag != tag)
+				continue;
+
+			if (entry.elementSize != elementSize || entry.offset % Section_Alignment != 0 || entry.offset > m_size || entry.count > (m_size - entry.offset) / elementSize)
+				return false;
+
+			*data = static_cast<const std::uint8_t*>(m_base) + entry.offset;
+			*count = static_cast<std::size_t>(entry.count);
+			return true;
+		}
+		return false;
+	}
+}
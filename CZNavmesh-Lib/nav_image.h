@@ -0,0 +1,144 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace navmesh {
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * A read-only file holding the tables a NavigationMap derives from its mesh, in a position independent form:
+	 * every reference is an index, so the file is used in place without being read or fixed up.
+	 * Every process loading the same map maps the same file read-only, so the operating system keeps a single
+	 * copy of it in memory for all of them.
+	 * The image is made for the .nav file with the given fingerprint, and the ladders of one level, identified
+	 * by a level key; it is only used for those.
+	 */
+	class NavImage {
+	public:
+		enum SectionTag : std::uint32_t {
+			LINK_SECTION = 0x4B4E494C,							///< 'LINK', see NavigationMap::BuildAreaGraph()
+			LINK_START_SECTION = 0x5453494C,					///< 'LIST'
+			INCOMING_START_SECTION = 0x54534E49,				///< 'INST'
+			INCOMING_LINK_SECTION = 0x4B4E4E49,					///< 'INNK'
+			PORTAL_SECTION = 0x54524F50,						///< 'PORT'
+			ENCOUNTER_SECTION = 0x52434E45,						///< 'ENCR', see NavigationMap::BuildEncounterIndex()
+			ENCOUNTER_START_SECTION = 0x54534E45,				///< 'ENST'
+			ENCOUNTER_TABLE_SECTION = 0x42544E45,				///< 'ENTB'
+			ENCOUNTER_SPOT_SECTION = 0x50534E45,				///< 'ENSP'
+			VISIBILITY_START_SECTION = 0x54535356,				///< 'VSST', see AreaVisibility::Build()
+			VISIBILITY_NUMBER_SECTION = 0x4D4E5356,				///< 'VSNM'
+			VISIBILITY_WORD_SECTION = 0x44575356,				///< 'VSWD'
+			VISIBILITY_FLAG_SECTION = 0x4C465356,				///< 'VSFL'
+		};
+
+		/// a section to write, as an array of trivially copyable elements
+		struct Section {
+			SectionTag tag;
+			const void* data;
+			std::uint32_t elementSize;
+			std::size_t count;
+		};
+
+		NavImage(const NavImage&) = delete;
+		NavImage& operator=(const NavImage&) = delete;
+		~NavImage();
+
+		/// return the image file to use for the given .nav file
+		static std::string GetPathFor(const std::string& navPath) { return navPath + ".image"; }
+
+		/// map the image read-only, return nullptr if there is none for this fingerprint and level key
+		static std::unique_ptr<NavImage> Open(const std::string& path, std::uint64_t fingerprint, std::uint64_t levelKey);
+
+		/**
+		 * Write the sections as an image. The file is written under another name and renamed into place, so
+		 * processes opening it never see it half written. If another process already made the image it is kept.
+		 */
+		static bool Write(const std::string& path, std::uint64_t fingerprint, std::uint64_t levelKey, const std::vector<Section>& sections);
+
+		/// return the elements of a section, false if it is missing or was written for another element size
+		template<typename T>
+		bool GetSection(SectionTag tag, std::span<const T>* elements) const {
+			static_assert(std::is_trivially_copyable_v<T>);
+			const void* data;
+			std::size_t count;
+			if (!FindSection(tag, sizeof(T), &data, &count))
+				return false;
+
+			*elements = { static_cast<const T*>(data), count };
+			return true;
+		}
+
+		/// the whole mapped file
+		std::span<const std::uint8_t> GetBytes() const noexcept { return { static_cast<const std::uint8_t*>(m_base), m_size }; }
+
+	private:
+		static constexpr std::uint32_t Magic = 0x494E5A43;		///< 'CZNI'
+		static constexpr std::uint32_t Version = 2;
+		static constexpr std::size_t Section_Alignment = 16;
+
+		const void* m_base;
+		std::size_t m_size;
+
+		NavImage(const void* base, std::size_t size) : m_base(base), m_size(size) { }
+		bool FindSection(SectionTag tag, std::uint32_t elementSize, const void** data, std::size_t* count) const;
+	};
+
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * An array built while loading a map, which may be replaced by a view of the same data in a NavImage.
+	 * Reading works the same either way; building goes through Edit(), which drops the view.
+	 */
+	template<typename T>
+	class ImageArray {
+		static_assert(std::is_trivially_copyable_v<T>);
+
+		std::vector<T> m_owned{};
+		const T* m_view{};										///< section of the image, nullptr if the array is owned
+		std::size_t m_viewSize{};
+
+	public:
+		const T* data() const noexcept { return m_view != nullptr ? m_view : m_owned.data(); }
+		std::size_t size() const noexcept { return m_view != nullptr ? m_viewSize : m_owned.size(); }
+		bool empty() const noexcept { return size() == 0; }
+		const T* begin() const noexcept { return data(); }
+		const T* end() const noexcept { return data() + size(); }
+		const T& operator[](std::size_t i) const { return data()[i]; }
+		const T& back() const { return data()[size() - 1]; }
+
+		/// elements owned by the array, not counting a view
+		std::size_t capacity() const noexcept { return m_owned.capacity(); }
+
+		std::vector<T>& Edit() {
+			DropView();
+			return m_owned;
+		}
+
+		void clear() { Edit().clear(); }
+
+		/// use a section of an image instead of the owned elements, which are kept until ReleaseOwned()
+		bool View(const NavImage& image, NavImage::SectionTag tag) {
+			std::span<const T> elements;
+			if (!image.GetSection(tag, &elements))
+				return false;
+
+			m_view = elements.data();
+			m_viewSize = elements.size();
+			return true;
+		}
+
+		/// go back to the owned elements
+		void DropView() noexcept {
+			m_view = nullptr;
+			m_viewSize = 0;
+		}
+
+		/// free the owned elements, once the view is certain to be kept
+		void ReleaseOwned() { std::vector<T>().swap(m_owned); }
+
+		NavImage::Section GetImageSection(NavImage::SectionTag tag) const { return { tag, data(), sizeof(T), size() }; }
+	};
+}
@@ -0,0 +1,62 @@
+#include "nav_loader.h"
+
+namespace navmesh {
+	bool AsyncNavLoader::Start(std::vector<std::string> paths, bool meshOnly) {
+		if (IsLoading())
+			return false;
+
+		m_map.reset();
+		m_path.clear();
+		m_finished = false;
+		m_engine.Open();
+
+		m_worker = std::thread([this, paths = std::move(paths), meshOnly] {
+			auto map = std::make_unique<NavigationMap>();
+			for (auto& path : paths) {
+				if (meshOnly ? map->LoadMesh(path, &m_engine) : map->Load(path, &m_engine)) {
+					m_map = std::move(map);
+					m_path = path;
+					break;
+				}
+			}
+			m_finished = true;
+		});
+		return true;
+	}
+
+	AsyncNavLoader::LoadStatus AsyncNavLoader::Update(std::chrono::microseconds budget) {
+		if (!IsLoading())
+			return LOAD_IDLE;
+
+		m_engine.Run(budget);
+		if (!m_finished)
+			return LOAD_RUNNING;
+
+		m_worker.join();
+
+		// messages the worker left after its last engine call
+		while (m_engine.Run(budget) > 0)
+			;
+		return m_map ? LOAD_DONE : LOAD_FAILED;
+	}
+
+	std::unique_ptr<NavigationMap> AsyncNavLoader::TakeMap(std::string* path) {
+		if (IsLoading())
+			return nullptr;
+
+		if (path != nullptr)
+			*path = m_path;
+
+		return std::move(m_map);
+	}
+
+	void AsyncNavLoader::Cancel() {
+		if (!IsLoading())
+			return;
+
+		// the worker gives up at its next engine call
+		m_engine.Close();
+		m_worker.join();
+		m_map.reset();
+	}
+}
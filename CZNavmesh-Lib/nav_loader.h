@@ -0,0 +1,57 @@
+#pragma once
+#include "engine_queue.h"
+#include "navigation_map.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace navmesh {
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * Loads a navigation map on a worker thread, so the server keeps running frames meanwhile.
+	 * The game thread calls Update() every frame, which does the engine work the load needs in bounded slices,
+	 * and hands over the finished map once, for the caller to swap in between frames.
+	 */
+	class AsyncNavLoader {
+	public:
+		enum LoadStatus {
+			LOAD_IDLE,											///< nothing is loading
+			LOAD_RUNNING,
+			LOAD_FAILED,										///< none of the files could be loaded
+			LOAD_DONE,											///< the map is ready to be taken with TakeMap()
+		};
+
+		AsyncNavLoader() = default;
+		AsyncNavLoader(const AsyncNavLoader&) = delete;
+		AsyncNavLoader& operator=(const AsyncNavLoader&) = delete;
+		~AsyncNavLoader() { Cancel(); }
+
+		/**
+		 * Start loading the first of 'paths' that loads; return false if a load is already running.
+		 * With 'meshOnly', only NavigationMap::LoadMesh() is done, which needs nothing from the current level.
+		 */
+		bool Start(std::vector<std::string> paths, bool meshOnly = false);
+
+		/// game thread, once per frame: run engine work for up to 'budget', and report how the load is going
+		LoadStatus Update(std::chrono::microseconds budget);
+
+		/// take the map finished by the last load, with the path it was loaded from
+		std::unique_ptr<NavigationMap> TakeMap(std::string* path = nullptr);
+
+		/// abandon the running load, if any; call it before the entities it traces against go away
+		void Cancel();
+
+		bool IsLoading() const noexcept { return m_worker.joinable(); }
+
+	private:
+		EngineQueue m_engine{};
+		std::thread m_worker{};
+		std::atomic<bool> m_finished = false;
+		std::unique_ptr<NavigationMap> m_map{};					///< owned by the worker until m_finished is set
+		std::string m_path{};
+	};
+}
@@ -0,0 +1,86 @@
+#include "nav_map_cache.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace navmesh {
+	void NavMapCache::Insert(std::unique_ptr<NavigationMap> map) {
+		// nothing to key an unloaded map by
+		if (map == nullptr || map->GetPath().empty())
+			return;
+
+		// drop the older copy
+		Take(map->GetPath());
+
+		const std::size_t Bytes = map->GetMemoryUsage();
+		m_entries.push_front({ map->GetPath(), Bytes, std::move(map) });
+		m_bytes += Bytes;
+		Evict();
+	}
+
+	std::unique_ptr<NavigationMap> NavMapCache::Take(const std::string& path) {
+		auto entry = std::find_if(m_entries.begin(), m_entries.end(), [&path](const Entry& e) { return e.path == path; });
+		if (entry == m_entries.end())
+			return nullptr;
+
+		std::unique_ptr<NavigationMap> map = std::move(entry->map);
+		m_bytes -= entry->bytes;
+		m_entries.erase(entry);
+
+		// the copy of a rewritten file is useless
+		if (!map->IsFileUnchanged())
+			return nullptr;
+
+		return map;
+	}
+
+	bool NavMapCache::Contains(const std::string& path) const {
+		return std::any_of(m_entries.begin(), m_entries.end(), [&path](const Entry& e) { return e.path == path; });
+	}
+
+	void NavMapCache::Clear() {
+		m_entries.clear();
+		m_bytes = 0;
+	}
+
+	void NavMapCache::SetMaxBytes(std::size_t maxBytes) {
+		m_maxBytes = maxBytes;
+		Evict();
+	}
+
+	void NavMapCache::Evict() {
+		// the most recent map stays even if it alone is over the cap
+		while (m_bytes > m_maxBytes && m_entries.size() > 1) {
+			m_bytes -= m_entries.back().bytes;
+			m_entries.pop_back();
+		}
+	}
+
+	std::string GetNextMapInCycle(const std::string& Mapcycle_Path, const std::string& Current_Map) {
+		std::ifstream file(Mapcycle_Path);
+		if (!file)
+			return {};
+
+		// one map per line, maybe followed by settings; "//" starts a comment
+		std::vector<std::string> maps;
+		for (std::string line; std::getline(file, line);) {
+			if (auto comment = line.find("//"); comment != std::string::npos)
+				line.erase(comment);
+
+			std::istringstream words(line);
+			if (std::string map; words >> map)
+				maps.push_back(map);
+		}
+
+		if (maps.empty())
+			return {};
+
+		auto current = std::find(maps.begin(), maps.end(), Current_Map);
+		if (current == maps.end() || ++current == maps.end())
+			return maps.front();
+
+		return *current;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "navigation_map.h"
+
+#include <list>
+#include <memory>
+#include <string>
+
+namespace navmesh {
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * Keeps navigation maps that are not in use, so going back to a map, or to one loaded ahead of time, needs no
+	 * file reads or parsing. Maps are kept by the .nav file they were loaded from, and only handed back while that
+	 * file keeps its size and modification time (see NavigationMap::IsFileUnchanged()), which needs no reads either.
+	 * The least recently used maps are dropped to stay under a memory cap.
+	 * Cached maps may only hold a mesh (see NavigationMap::LoadMesh()); whoever takes one attaches it to the level.
+	 * It must only be used from the game thread.
+	 */
+	class NavMapCache {
+	public:
+		static constexpr std::size_t Default_Max_Bytes = 256u << 20;
+
+		explicit NavMapCache(std::size_t maxBytes = Default_Max_Bytes) : m_maxBytes(maxBytes) { }
+
+		/// keep a map nobody uses anymore, replacing any older copy of the same file
+		void Insert(std::unique_ptr<NavigationMap> map);
+
+		/// take out the map loaded from 'path', unless it is not cached or the file changed since
+		std::unique_ptr<NavigationMap> Take(const std::string& path);
+
+		bool Contains(const std::string& path) const;
+		void Clear();
+
+		void SetMaxBytes(std::size_t maxBytes);
+		std::size_t GetMemoryUsage() const noexcept { return m_bytes; }
+		std::size_t GetCount() const noexcept { return m_entries.size(); }
+
+	private:
+		struct Entry {
+			std::string path;
+			std::size_t bytes;
+			std::unique_ptr<NavigationMap> map;
+		};
+
+		std::list<Entry> m_entries{};							///< most recently used first
+		std::size_t m_bytes = 0;
+		std::size_t m_maxBytes;
+
+		void Evict();
+	};
+
+	/**
+	 * Return the map that follows 'Current_Map' in the mapcycle file, or the first one if it is not in there.
+	 * Return an empty string if the file cannot be read or lists no maps.
+	 */
+	std::string GetNextMapInCycle(const std::string& Mapcycle_Path, const std::string& Current_Map);
+}
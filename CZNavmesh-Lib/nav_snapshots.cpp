@@ -0,0 +1,63 @@
+#include "nav_snapshots.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace navmesh {
+	NavSnapshots::NavSnapshots() : m_currentOwner(std::make_unique<NavigationMap>()) {
+		m_current.store(m_currentOwner.get(), std::memory_order_release);
+	}
+
+	NavSnapshots::ReaderId NavSnapshots::RegisterReader() {
+		std::scoped_lock lock(m_mutex);
+		for (ReaderId i = 0; i < Max_Readers; ++i) {
+			if (!m_readers[i].used) {
+				m_readers[i].used = true;
+				m_readers[i].epoch.store(m_epoch.load(std::memory_order_acquire), std::memory_order_release);
+				return i;
+			}
+		}
+		return No_Reader;
+	}
+
+	void NavSnapshots::UnregisterReader(ReaderId reader) {
+		if (reader >= Max_Readers)
+			return;
+
+		std::scoped_lock lock(m_mutex);
+		m_readers[reader].used = false;
+		m_readers[reader].epoch.store(Offline, std::memory_order_release);
+	}
+
+	void NavSnapshots::Quiescent(ReaderId reader) noexcept {
+		if (reader < Max_Readers)
+			m_readers[reader].epoch.store(m_epoch.load(std::memory_order_acquire), std::memory_order_release);
+	}
+
+	void NavSnapshots::Publish(std::unique_ptr<NavigationMap> map) {
+		std::scoped_lock lock(m_mutex);
+		m_current.store(map.get(), std::memory_order_seq_cst);
+
+		// a reader that sees the new epoch will also see the new map
+		const std::uint64_t Retired_Epoch = m_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+		m_retired.push_back({ std::exchange(m_currentOwner, std::move(map)), Retired_Epoch });
+	}
+
+	std::size_t NavSnapshots::Reclaim(std::vector<std::unique_ptr<NavigationMap>>* freed) {
+		std::scoped_lock lock(m_mutex);
+
+		std::uint64_t oldest = Offline;
+		for (auto& slot : m_readers)
+			oldest = (std::min)(oldest, slot.epoch.load(std::memory_order_acquire));
+
+		std::erase_if(m_retired, [oldest, freed](RetiredMap& retired) {
+			if (retired.epoch > oldest)
+				return false;
+
+			if (freed != nullptr)
+				freed->push_back(std::move(retired.map));
+			return true;
+		});
+		return m_retired.size();
+	}
+}
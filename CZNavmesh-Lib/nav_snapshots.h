@@ -0,0 +1,95 @@
+#pragma once
+#include "navigation_map.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace navmesh {
+	/**
+	 * A map published by NavSnapshots, and everything in it, valid until its reader's next quiescent point.
+	 * The epoch tells state kept across quiescent points, such as area indices, which map it was made for; a map
+	 * that was never published has epoch zero.
+	 */
+	class NavSnapshot {
+	public:
+		explicit NavSnapshot(const NavigationMap* map, std::uint64_t epoch = 0) noexcept : m_map(map), m_epoch(epoch) { }
+
+		const NavigationMap* get() const noexcept { return m_map; }
+		const NavigationMap* operator->() const noexcept { return m_map; }
+		const NavigationMap& operator*() const noexcept { return *m_map; }
+		std::uint64_t GetEpoch() const noexcept { return m_epoch; }
+
+	private:
+		const NavigationMap* m_map;
+		std::uint64_t m_epoch;
+	};
+
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * Holds the current navigation map for any number of reader threads, and replaces it without stopping them.
+	 * A published map is never changed again. Replacing it only retires it, and it is freed once every reader
+	 * has passed a quiescent point - a moment where it holds nothing from any map, like the start of a frame.
+	 * So reading costs a single load, with no locks or read-modify-write operations; only publishing and
+	 * reclaiming take a lock.
+	 * Readers must not keep pointers into a map, such as NavArea pointers, past their next quiescent point; what
+	 * they keep longer, such as a planned path, must be checked against the epoch of the next snapshot they read.
+	 */
+	class NavSnapshots {
+	public:
+		using ReaderId = std::uint32_t;
+		static constexpr std::size_t Max_Readers = 64;
+		static constexpr ReaderId No_Reader = ~0u;
+
+		/// starts with an empty map, so there is always one to read
+		NavSnapshots();
+		NavSnapshots(const NavSnapshots&) = delete;
+		NavSnapshots& operator=(const NavSnapshots&) = delete;
+
+		/// register the calling thread as a reader; return No_Reader if there are too many
+		ReaderId RegisterReader();
+		void UnregisterReader(ReaderId reader);
+
+		/// the epoch is read first: seeing a newer map under the older epoch only makes the reader start over once more
+		NavSnapshot Read() const noexcept {
+			const std::uint64_t Epoch = m_epoch.load(std::memory_order_acquire);
+			return NavSnapshot(m_current.load(std::memory_order_acquire), Epoch);
+		}
+
+		/// changes every time a map is published, so a reader can tell it is looking at a different one
+		std::uint64_t GetEpoch() const noexcept { return m_epoch.load(std::memory_order_acquire); }
+
+		/// the reader holds nothing from any map at this point
+		void Quiescent(ReaderId reader) noexcept;
+
+		/// make 'map' the current one, retiring the one it replaces
+		void Publish(std::unique_ptr<NavigationMap> map);
+
+		/// free the retired maps no reader can still hold, or move them to 'freed'; return how many are left waiting
+		std::size_t Reclaim(std::vector<std::unique_ptr<NavigationMap>>* freed = nullptr);
+
+	private:
+		static constexpr std::uint64_t Offline = ~0ull;		///< epoch of a slot without a reader
+
+		/// what each reader last saw of the epoch, on its own cache line so readers do not slow each other down
+		struct alignas(64) ReaderSlot {
+			std::atomic<std::uint64_t> epoch = Offline;
+			bool used = false;
+		};
+
+		struct RetiredMap {
+			std::unique_ptr<NavigationMap> map;
+			std::uint64_t epoch;								///< readers at or past this epoch cannot hold the map
+		};
+
+		std::atomic<const NavigationMap*> m_current{};
+		std::atomic<std::uint64_t> m_epoch = 1;
+		ReaderSlot m_readers[Max_Readers]{};
+
+		std::mutex m_mutex;
+		std::unique_ptr<NavigationMap> m_currentOwner{};
+		std::vector<RetiredMap> m_retired{};
+	};
+}
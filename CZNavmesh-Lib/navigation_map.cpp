@@ -13,13 +13,24 @@
 *
 ****/
 #include "navigation_map.h"
+#include "entity_class_table.h"
+#include "ground_height_cache.h"
+#include "nav_cache.h"
 #include <vector>
 #include <string>
 
 #include <optional>
 
+#include <algorithm>
+#include <array>
 #include <format>
 #include <cassert>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <execution>
+#include <limits>
+#include <tuple>
 #include <unordered_map>
 
 
@@ -70,68 +81,51 @@ namespace {
 }
 
 namespace navmesh {
-	constexpr float GenerationStepSize = 25.0f;		// (30) was 20, but bots can't fit always fit
-	constexpr float StepHeight = 18.0f;						///< if delta Z is greater than this, we have to jump to get up
-	constexpr float JumpHeight = 41.8f;						///< if delta Z is less than this, we can jump up on it
-	constexpr float JumpCrouchHeight = 58.0f;			///< (48) if delta Z is less than or equal to this, we can jumpcrouch up on it
-
-	// Strictly speaking, you CAN get up a slope of 1.643 (about 59 degrees), but you move very, very slowly
-	// This slope will represent the slope you can navigate without much slowdown
-	constexpr float MaxSlope = 1.4f;							///< rise/run - if greater than this, we can't move up it (de_survivor canyon ramps)
-
-	// instead of MaxSlope, we are using the following max Z component of a unit normal
-	constexpr float MaxUnitZSlope = 0.7f;
-
-	constexpr float BotRadius = 10.0f;						///< circular extent that contains bot
-	constexpr float DeathDrop = 200.0f;						///< (300) distance at which we will die if we fall - should be about 600, and pay attention to fall damage during pathfind
-
-	constexpr float HalfHumanWidth = 16.0f;
-	constexpr float HalfHumanHeight = 36.0f;
-	constexpr float HumanHeight = 72.0f;
-
 	//--------------------------------------------------------------------------------------------------------------
 	/**
-	 * Return the ground height below this point in "height".
-	 * Return false if position is invalid (outside of map, in a solid area, etc).
+	 * Trace down from a little above 'pos', and collect the ground layers found in "layer", from the lowest up.
+	 * Return the number of layers, and the number of traces made in "traceCount".
 	 */
-	bool GetGroundHeight(const Vector* pos, float* height, Vector* normal = nullptr) {
+	constexpr auto MAX_GROUND_LAYERS = 16;
+
+	int TraceGroundLayers(const Vector* pos, GroundLayer* layer, std::uint32_t* traceCount) {
 		Vector to{ pos->x, pos->y, pos->z - 9999.9f };
 
 		float offset;
 		Vector from;
 		TraceResult result;
-		edict_t* ignore = nullptr;
-		float ground = 0.0f;
+
+		// how many doors or breakables stacked on top of each other a single trace passes through
+		constexpr int maxIgnore = 8;
 
 		constexpr float maxOffset = 100.0f;
 		constexpr float inc = 10.0f;
 
-		constexpr auto MAX_GROUND_LAYERS = 16;
-		struct GroundLayerInfo {
-			float ground{};
-			Vector normal{};
-		} layer[MAX_GROUND_LAYERS]{};
 		int layerCount = 0;
+		*traceCount = 0;
 
 		for (offset = 1.0f; offset < maxOffset; offset += inc) {
 			from = *pos + Vector(0, 0, offset);
-			UTIL_TraceLine(from, to, ignore_monsters, dont_ignore_glass, ignore, &result);
+			UTIL_TraceLine(from, to, ignore_monsters, dont_ignore_glass, nullptr, &result);
+			++*traceCount;
+			const bool startSolid = result.fStartSolid != false;
 
-			// if the trace came down thru a door, ignore the door and try again
+			// if the trace came down thru a door, ignore the door and carry on from just below where it was hit
 			// also ignore breakable floors
-			if (result.pHit) {
-				if (FClassnameIs(VARS(result.pHit), "func_door") ||
-					FClassnameIs(VARS(result.pHit), "func_door_rotating") ||
-					(FClassnameIs(VARS(result.pHit), "func_breakable") && VARS(result.pHit)->takedamage == DAMAGE_YES)) {
-					ignore = result.pHit;
-					// keep incrementing to avoid infinite loop if more than one entity is along the traceline...
-					/// @todo Deal with multiple ignore entities in a single TraceLine()
-					//offset -= inc;
-					continue;
-				}
+			int ignoreCount = 0;
+			while (result.pHit && entity_class_table.IsGroundTraceIgnorable(result.pHit) && ignoreCount < maxIgnore) {
+				edict_t* ignore = result.pHit;
+				from = result.vecEndPos - Vector(0, 0, 0.1f);
+				UTIL_TraceLine(from, to, ignore_monsters, dont_ignore_glass, ignore, &result);
+				++*traceCount;
+				++ignoreCount;
 			}
 
-			if (result.fStartSolid == false) {
+			// too many entities in the way - skip this offset rather than loop forever
+			if (result.pHit && entity_class_table.IsGroundTraceIgnorable(result.pHit))
+				continue;
+
+			if (startSolid == false && result.fStartSolid == false) {
 				// if we didnt start inside a solid area, the trace hit a ground layer
 
 				// if this is a new ground layer, add it to the set
@@ -145,7 +139,31 @@ namespace navmesh {
 				}
 			}
 		}
+		return layerCount;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * Return the ground height below this point in "height".
+	 * Return false if position is invalid (outside of map, in a solid area, etc).
+	 * With a cache, the layers of the cache cell containing 'pos' are traced once and then reused.
+	 */
+	bool GetGroundHeight(const Vector* pos, float* height, Vector* normal = nullptr, GroundHeightCache* cache = nullptr) {
+		GroundLayer traced[MAX_GROUND_LAYERS]{};
+		std::span<const GroundLayer> layer;
+
+		if (cache == nullptr || !cache->Find(*pos, &layer)) {
+			std::uint32_t traceCount;
+			if (cache == nullptr) {
+				layer = { traced, static_cast<std::size_t>(TraceGroundLayers(pos, traced, &traceCount)) };
+			} else {
+				const Vector Center = GroundHeightCache::GetCellCenter(*pos);
+				layer = { traced, static_cast<std::size_t>(TraceGroundLayers(&Center, traced, &traceCount)) };
+				cache->Store(*pos, layer, traceCount);
+			}
+		}
 
+		const int layerCount = static_cast<int>(layer.size());
 		if (layerCount == 0)
 			return false;
 
@@ -256,14 +274,31 @@ namespace navmesh {
 	}
 
 	/**
-	 * Given a HidingSpot ID, return the associated HidingSpot
+	 * Index the IDs of the hiding spots, for FindSpotIndex()
 	 */
-	HidingSpot* NavigationMap::GetHidingSpotByID(std::uint32_t id) {
-		for (auto& spot : m_hidingSpots) {
-			if (spot->m_id == id)
-				return spot;
-		}
-		return nullptr;
+	void NavigationMap::IndexSpotIDs() {
+		m_spotIndexByID.clear();
+		m_spotIndexByID.reserve(m_spotByIndex.size());
+		for (auto& spot : m_spotByIndex)
+			m_spotIndexByID.emplace_back(spot->m_id, spot->m_index);
+
+		// sorted by index too, so a duplicate ID finds the spot read first
+		std::sort(m_spotIndexByID.begin(), m_spotIndexByID.end());
+	}
+
+	/**
+	 * Given a HidingSpot ID, return the index of the associated HidingSpot, or Invalid_Index
+	 */
+	std::uint32_t NavigationMap::FindSpotIndex(std::uint32_t id) const {
+		const auto It = std::lower_bound(m_spotIndexByID.begin(), m_spotIndexByID.end(), std::make_pair(id, std::uint32_t{}));
+		return It != m_spotIndexByID.end() && It->first == id ? It->second : Invalid_Index;
+	}
+
+	HidingSpot::HidingSpot() {
+		m_pos = Vector(0, 0, 0);
+		m_id = 0;
+		m_flags = 0;
+		m_index = Invalid_Index;
 	}
 
 	HidingSpot::HidingSpot(NavigationMap* mesh) {
@@ -287,13 +322,12 @@ namespace navmesh {
 
 	void PlaceDirectory::Reset(void) {
 		m_directory.clear();
+		m_entryOfPlace.fill(0);
 	}
 
 	/// return true if this place is already in the directory
 	bool PlaceDirectory::IsKnown(Place place) const {
-		std::vector<Place>::const_iterator it = std::find(m_directory.begin(), m_directory.end(), place);
-
-		return (it != m_directory.end());
+		return place != Undefined_Place && place <= Max_Place && m_entryOfPlace[place] != 0;
 	}
 
 	/// return the directory entry corresponding to this Place (0 = no entry)
@@ -301,13 +335,12 @@ namespace navmesh {
 		if (place == Undefined_Place)
 			return 0;
 
-		std::vector<Place>::const_iterator it = std::find(m_directory.begin(), m_directory.end(), place);
-		if (it == m_directory.end()) {
+		if (!IsKnown(place)) {
 			assert(false && "PlaceDirectory::GetEntry failure");
 			return 0;
 		}
 
-		return 1 + (it - m_directory.begin());
+		return m_entryOfPlace[place];
 	}
 
 	/// add the place to the directory if not already known
@@ -315,12 +348,19 @@ namespace navmesh {
 		if (place == Undefined_Place)
 			return;
 
-		assert(place < 1000);
+		assert(place <= Max_Place);
 
 		if (IsKnown(place))
 			return;
 
+		AddEntry(place);
+	}
+
+	/// add an entry for the place, even if it is already known or undefined, so the entries after it keep their number
+	void PlaceDirectory::AddEntry(Place place) {
 		m_directory.push_back(place);
+		if (place != Undefined_Place && place <= Max_Place && m_entryOfPlace[place] == 0)
+			m_entryOfPlace[place] = static_cast<EntryType>(m_directory.size());
 	}
 
 	/// given an entry, return the Place
@@ -328,17 +368,23 @@ namespace navmesh {
 		if (entry == 0)
 			return Undefined_Place;
 
-		int i = entry - 1;
+		const std::size_t I = entry - 1;
 
-		if (i > m_directory.size()) {
+		if (I >= m_directory.size()) {
 			assert(false && "PlaceDirectory::EntryToPlace: Invalid entry");
 			return Undefined_Place;
 		}
 
-		return m_directory[i];
+		return m_directory[I];
 	}
 
 	void NavigationMap::DestroyLadders() {
+		// the areas must not keep pointers to the ladders we are about to delete
+		for (auto area : m_areas) {
+			area->m_ladder[LADDER_UP].clear();
+			area->m_ladder[LADDER_DOWN].clear();
+		}
+
 		while (!m_navLadders.empty()) {
 			NavLadder* ladder = m_navLadders.front();
 			m_navLadders.pop_front();
@@ -435,34 +481,105 @@ namespace navmesh {
 	 * Start at given position and find first area in given direction
 	 */
 	NavArea* NavigationMap::FindFirstAreaInDirection(const Vector* start, NavDirType dir, float range, float beneathLimit, edict_t* traceIgnore, Vector* closePos) {
-		Vector pos = *start;
-
 		int end = (int)((range / GenerationStepSize) + 0.5f);
-		NavArea* area{};
-		for (int i = 1; i <= end; i++) {
-			AddDirectionVector(&pos, dir, GenerationStepSize);
 
-			// make sure we dont look thru the wall
-			TraceResult result;
+		// find the first step that lands on an area without touching the engine
+		const int Step = m_navAreaGrid.FindFirstStepOnArea(start, dir, GenerationStepSize, end, beneathLimit);
+		if (Step == 0)
+			return nullptr;
 
-			if (traceIgnore)
-				UTIL_TraceLine(*start, pos, ignore_monsters, traceIgnore, &result);
-			else
-				UTIL_TraceLine(*start, pos, ignore_monsters, nullptr, &result);
+		Vector pos = *start;
+		AddDirectionVector(&pos, dir, Step * GenerationStepSize);
 
-			if (result.flFraction != 1.0f)
-				break;
+		// make sure we dont look thru the wall - if nothing blocks the way to this step, nothing blocks the steps before it
+		TraceResult result;
+		UTIL_TraceLine(*start, pos, ignore_monsters, traceIgnore, &result);
+		if (result.flFraction != 1.0f)
+			return nullptr;
+
+		NavArea* area = m_navAreaGrid.GetNavArea(&pos, beneathLimit);
+		if (area != nullptr && closePos) {
+			closePos->x = pos.x;
+			closePos->y = pos.y;
+			closePos->z = area->GetZ(pos.x, pos.y);
+		}
+		return area;
+	}
+
+	int NavAreaGrid::FindFirstStepOnArea(const Vector* start, NavDirType dir, float step, int count, float beneathLimit) const {
+		if (m_grid == nullptr || count < 1)
+			return 0;
 
-			if (area = m_navAreaGrid.GetNavArea(&pos, beneathLimit); area != nullptr) {
-				if (closePos) {
-					closePos->x = pos.x;
-					closePos->y = pos.y;
-					closePos->z = area->GetZ(pos.x, pos.y);
+		// the ray runs along one axis, so it stays in one row or column of cells
+		const bool AlongX = (dir == EAST || dir == WEST);
+		const float Sign = (dir == EAST || dir == SOUTH) ? 1.0f : -1.0f;
+		const float Origin = AlongX ? start->x : start->y;
+		const float Min = AlongX ? m_minX : m_minY;
+		const int Size = AlongX ? m_gridSizeX : m_gridSizeY;
+		auto cellOf = [&](int i) {
+			const float Coord = Origin + Sign * i * step;
+			return AlongX ? WorldToGridX(Coord) : WorldToGridY(Coord);
+		};
+		auto stepPos = [&](int i) {
+			Vector pos = *start;
+			AddDirectionVector(&pos, dir, i * step);
+			return pos;
+		};
+
+		const int Fixed_X = WorldToGridX(start->x), Fixed_Y = WorldToGridY(start->y);
+		int cell = cellOf(1);
+		for (int first = 1; first <= count; cell += static_cast<int>(Sign)) {
+			// the steps that fall in this cell
+			int last = count;
+			if (Sign > 0.0f && cell < Size - 1)
+				last = (std::min)(count, static_cast<int>(std::ceil((Min + (cell + 1) * m_cellSize - Origin) / step)) - 1);
+			else if (Sign < 0.0f && cell > 0)
+				last = (std::min)(count, static_cast<int>(std::floor((Origin - (Min + cell * m_cellSize)) / step)));
+
+			// settle rounding at the cell border the same way GetNavArea() would
+			while (last < count && cellOf(last + 1) == cell)
+				++last;
+			while (last >= first && cellOf(last) != cell)
+				--last;
+
+			int best = 0;
+			const auto& list = m_grid[AlongX ? cell + Fixed_Y * m_gridSizeX : Fixed_X + cell * m_gridSizeX];
+			for (auto area : list) {
+				// the steps within the area, give or take one for rounding - each is checked exactly below
+				const float Lo = AlongX ? area->m_extent.lo.x : area->m_extent.lo.y;
+				const float Hi = AlongX ? area->m_extent.hi.x : area->m_extent.hi.y;
+				const float Enter = (Sign > 0.0f) ? Lo - Origin : Origin - Hi;
+				const float Exit = (Sign > 0.0f) ? Hi - Origin : Origin - Lo;
+				int lo = (std::max)(first, static_cast<int>(std::floor(Enter / step)));
+				int hi = (std::min)(last, static_cast<int>(std::ceil(Exit / step)));
+				if (best != 0)
+					hi = (std::min)(hi, best - 1);
+
+				for (int i = lo; i <= hi; ++i) {
+					const Vector Pos = stepPos(i);
+					const Vector Test_Pos = Pos + Vector(0, 0, 5);
+					if (cellOf(i) != cell || !area->IsOverlapping(&Test_Pos))
+						continue;
+
+					// same height test as GetNavArea()
+					const float Z = area->GetZ(&Test_Pos);
+					if (Z > Test_Pos.z || Z < Pos.z - beneathLimit)
+						continue;
+
+					best = i;
+					break;
 				}
-				break;
 			}
+
+			// cells are visited in order, so the first hit is the nearest
+			if (best != 0)
+				return best;
+
+			first = (std::max)(first, last + 1);
+			if (cell < 0 || cell >= Size)
+				break;
 		}
-		return area;
+		return 0;
 	}
 
 	//--------------------------------------------------------------------------------------------------------------
@@ -581,654 +698,2126 @@ namespace navmesh {
 	//--------------------------------------------------------------------------------------------------------------
 	/**
 	 * For each ladder in the map, create a navigation representation of it.
+	 * Engine traces are made up front and at the end, with the work in between done for all ladders in parallel.
+	 * The results are kept in the nav cache, and reused as long as the .nav file and the ladders are unchanged.
+	 * Return false if the game thread stopped taking engine work before the ladders were done.
 	 */
-	void NavigationMap::BuildLadders() {
+	bool NavigationMap::BuildLadders(NavCache* cache) {
 		// remove any left-over ladders
 		DestroyLadders();
 
-		TraceResult result;
-		edict_t* entity = FindEntityByClassname(nullptr, "func_ladder");
-		while (entity) {
-			NavLadder* ladder = new NavLadder;
+		// the cache holds everything below for these exact ladders, skipping every trace
+		std::vector<edict_t*> entities;
+		bool loaded = false;
+		const bool Found = RunOnGameThread([&] {
+			for (edict_t* entity = FindEntityByClassname(nullptr, "func_ladder"); entity != nullptr; entity = FindEntityByClassname(entity, "func_ladder"))
+				entities.push_back(entity);
+
+			loaded = cache != nullptr && LoadLadders(*cache, entities);
+		});
+
+		if (!Found || loaded)
+			return Found;
+
+		// ladders per slice of engine work, when loading on another thread
+		constexpr std::size_t traceSliceSize = 4;
+		constexpr std::size_t confirmSliceSize = 16;
+
+		constexpr float nearLadderRange = 75.0f;		// 50
+		constexpr float beneathLimit = 120.0f;
+
+		/// what is learned about one ladder, phase by phase
+		struct LadderWork {
+			edict_t* entity;
+			NavLadder* ladder;
+			NavArea* bottomQuick;								///< area directly below the bottom, if any
+			bool hasBottomSource;
+			Vector bottomSource;								///< where to search for the nearest area from, if there is none below
+			NavDirType probeDir[4];								///< forward, left, right and behind, as seen from the ladder
+			int probeStep[4];									///< first step of each probe landing on an area, zero for none
+		};
+		std::vector<LadderWork> work(entities.size());
+
+		for (auto& w : work)
+			w.ladder = new NavLadder;
+
+		// until they are attached, the ladders are only known to the work list
+		auto abandon = [&work] {
+			for (auto& w : work)
+				delete w.ladder;
+			return false;
+		};
+
+		// Phase 1: the traces that decide the ladder geometry. The engine can only be used from the game thread.
+		for (std::size_t first = 0; first < work.size(); first += traceSliceSize) {
+			const std::size_t Last = (std::min)(first + traceSliceSize, work.size());
+			const bool Traced = RunOnGameThread([&, first, Last] {
+				for (std::size_t i = first; i < Last; ++i) {
+					LadderWork& w = work[i];
+					w.entity = entities[i];
+					TraceLadder(w.ladder, w.entity);
+
+					// get approximate postion of player on ladder
+					Vector center = w.ladder->m_bottom + Vector(0, 0, GenerationStepSize);
+					AddDirectionVector(&center, w.ladder->m_dir, HalfHumanWidth);
+
+					// same as GetNearestNavArea(), with the ground trace done here
+					w.bottomQuick = m_navAreaGrid.GetNavArea(&center);
+					w.hasBottomSource = w.bottomQuick == nullptr && GetGroundHeight(&center, &w.bottomSource.z, nullptr, &m_groundHeightCache);
+					w.bottomSource.x = center.x;
+					w.bottomSource.y = center.y;
+					w.bottomSource.z += HalfHumanHeight;
+				}
+			});
 
-			// compute top & bottom of ladder
-			ladder->m_top.x = (entity->v.absmin.x + entity->v.absmax.x) / 2.0f;
-			ladder->m_top.y = (entity->v.absmin.y + entity->v.absmax.y) / 2.0f;
-			ladder->m_top.z = entity->v.absmax.z;
+			if (!Traced)
+				return abandon();
+		}
 
-			ladder->m_bottom.x = ladder->m_top.x;
-			ladder->m_bottom.y = ladder->m_top.y;
-			ladder->m_bottom.z = entity->v.absmin.z;
+		// Phase 2: attach the ladders to the mesh. This only reads areas, so ladders are done in parallel.
+		std::for_each(std::execution::par, work.begin(), work.end(), [this](LadderWork& w) {
+			NavLadder* ladder = w.ladder;
+			if (w.bottomQuick != nullptr) {
+				ladder->m_bottomArea = w.bottomQuick;
+			} else if (w.hasBottomSource) {
+				float closeDistSq = 99999999.9f;
+				for (auto area : m_areas) {
+					Vector areaPos;
+					area->GetClosestPointOnArea(&w.bottomSource, &areaPos);
+
+					const Vector Delta = areaPos - w.bottomSource;
+					const float DistSq = Delta.x * Delta.x + Delta.y * Delta.y + Delta.z * Delta.z;
+					if (DistSq < closeDistSq) {
+						closeDistSq = DistSq;
+						ladder->m_bottomArea = area;
+					}
+				}
+			}
 
-			// determine facing - assumes "normal" runged ladder
-			float xSize = entity->v.absmax.x - entity->v.absmin.x;
-			float ySize = entity->v.absmax.y - entity->v.absmin.y;
-			if (xSize > ySize) {
-				// ladder is facing north or south - determine which way
-				// "pull in" traceline from bottom and top in case ladder abuts floor and/or ceiling
-				const Vector from = ladder->m_bottom + Vector(0.0f, GenerationStepSize, GenerationStepSize);
-				const Vector to = ladder->m_top + Vector(0.0f, GenerationStepSize, -GenerationStepSize);
+			Vector center = ladder->m_top + Vector(0, 0, GenerationStepSize);
+			AddDirectionVector(&center, ladder->m_dir, HalfHumanWidth);
 
-				UTIL_TraceLine(from, to, ignore_monsters, ENT(entity), &result);
+			// look farther behind, since ladder is against the wall away from that area
+			const NavDirType Dirs[4] = { OppositeDirection(ladder->m_dir), DirectionLeft(ladder->m_dir), DirectionRight(ladder->m_dir), ladder->m_dir };
+			const float Ranges[4] = { nearLadderRange, nearLadderRange, nearLadderRange, 2.0f * nearLadderRange };
+			for (int p = 0; p < 4; ++p) {
+				const int End = (int)((Ranges[p] / GenerationStepSize) + 0.5f);
+				w.probeDir[p] = Dirs[p];
+				w.probeStep[p] = m_navAreaGrid.FindFirstStepOnArea(&center, Dirs[p], GenerationStepSize, End, beneathLimit);
+			}
+		});
+
+		// Phase 3: confirm the probes with one trace each, as FindFirstAreaInDirection() does, and finish up
+		for (std::size_t first = 0; first < work.size(); first += confirmSliceSize) {
+			const std::size_t Last = (std::min)(first + confirmSliceSize, work.size());
+			const bool Confirmed = RunOnGameThread([&, first, Last] {
+				for (std::size_t i = first; i < Last; ++i) {
+					LadderWork& w = work[i];
+					NavLadder* ladder = w.ladder;
+					if (!ladder->m_bottomArea)
+						ALERT(at_console, "ERROR: Unconnected ladder bottom at ( %g, %g, %g )\n", ladder->m_bottom.x, ladder->m_bottom.y, ladder->m_bottom.z);
+
+					Vector center = ladder->m_top + Vector(0, 0, GenerationStepSize);
+					AddDirectionVector(&center, ladder->m_dir, HalfHumanWidth);
+
+					NavArea* topAreaList[4]{};
+					for (int p = 0; p < 4; ++p) {
+						if (w.probeStep[p] == 0)
+							continue;
+
+						Vector pos = center;
+						AddDirectionVector(&pos, w.probeDir[p], w.probeStep[p] * GenerationStepSize);
+
+						// make sure we dont look thru the wall
+						TraceResult result;
+						UTIL_TraceLine(center, pos, ignore_monsters, w.entity, &result);
+						if (result.flFraction != 1.0f)
+							continue;
 
-				if (result.flFraction != 1.0f || result.fStartSolid)
-					ladder->m_dir = NORTH;
-				else
-					ladder->m_dir = SOUTH;
-			} else {
-				// ladder is facing east or west - determine which way
-				const Vector from = ladder->m_bottom + Vector(GenerationStepSize, 0.0f, GenerationStepSize);
-				const Vector to = ladder->m_top + Vector(GenerationStepSize, 0.0f, -GenerationStepSize);
+						topAreaList[p] = m_navAreaGrid.GetNavArea(&pos, beneathLimit);
+						if (topAreaList[p] == ladder->m_bottomArea)
+							topAreaList[p] = nullptr;
+					}
+					ladder->m_topForwardArea = topAreaList[0];
+					ladder->m_topLeftArea = topAreaList[1];
+					ladder->m_topRightArea = topAreaList[2];
+					ladder->m_topBehindArea = topAreaList[3];
+
+					// can't include behind area, since it is not used when going up a ladder
+					if (!ladder->m_topForwardArea && !ladder->m_topLeftArea && !ladder->m_topRightArea)
+						ALERT(at_console, "ERROR: Unconnected ladder top at ( %g, %g, %g )\n", ladder->m_top.x, ladder->m_top.y, ladder->m_top.z);
+
+					// adjust top of ladder to highest connected area
+					float topZ = -99999.9f;
+					bool topAdjusted = false;
+					for (int a = 0; a < 4; ++a) {
+						NavArea* topArea = topAreaList[a];
+						if (topArea == nullptr)
+							continue;
+
+						Vector close;
+						topArea->GetClosestPointOnArea(&ladder->m_top, &close);
+						if (topZ < close.z) {
+							topZ = close.z;
+							topAdjusted = true;
+						}
+					}
 
-				UTIL_TraceLine(from, to, ignore_monsters, ENT(entity), &result);
+					if (topAdjusted)
+						ladder->m_top.z = topZ;
+
+					//
+					// Determine whether this ladder is "dangling" or not
+					// "Dangling" ladders are too high to go up
+					//
+					ladder->m_isDangling = false;
+					if (ladder->m_bottomArea) {
+						Vector bottomSpot;
+						ladder->m_bottomArea->GetClosestPointOnArea(&ladder->m_bottom, &bottomSpot);
+						if (ladder->m_bottom.z - bottomSpot.z > HumanHeight)
+							ladder->m_isDangling = true;
+					}
+				}
+			});
 
-				if (result.flFraction != 1.0f || result.fStartSolid)
-					ladder->m_dir = WEST;
-				else
-					ladder->m_dir = EAST;
-			}
+			if (!Confirmed)
+				return abandon();
+		}
 
-			// adjust top and bottom of ladder to make sure they are reachable
-			// (cs_office has a crate right in front of the base of a ladder)
-			const Vector along = (ladder->m_top - ladder->m_bottom).Normalize();
-			const float length = along.Length();
-			Vector on, out;
-			constexpr float minLadderClearance = 32.0f;
+		for (auto& w : work)
+			AttachLadder(w.ladder);
 
-			// adjust bottom to bypass blockages
-			constexpr float inc = 10.0f;
-			for (float t = 0.0f; t <= length; t += inc) {
-				on = ladder->m_bottom + t * along;
+		if (cache != nullptr) {
+			SaveLadders(cache);
+			cache->Write();
+		}
+		return true;
+	}
 
-				out = on;
-				AddDirectionVector(&out, ladder->m_dir, minLadderClearance);
+	/**
+	 * Find the top, bottom and facing of a ladder entity.
+	 */
+	void NavigationMap::TraceLadder(NavLadder* ladder, edict_t* entity) {
+		TraceResult result;
 
-				UTIL_TraceLine(on, out, ignore_monsters, ENT(entity), &result);
+		// compute top & bottom of ladder
+		ladder->m_top.x = (entity->v.absmin.x + entity->v.absmax.x) / 2.0f;
+		ladder->m_top.y = (entity->v.absmin.y + entity->v.absmax.y) / 2.0f;
+		ladder->m_top.z = entity->v.absmax.z;
 
-				if (result.flFraction == 1.0f && !result.fStartSolid) {
-					// found viable ladder bottom
-					ladder->m_bottom = on;
-					break;
-				}
-			}
+		ladder->m_bottom.x = ladder->m_top.x;
+		ladder->m_bottom.y = ladder->m_top.y;
+		ladder->m_bottom.z = entity->v.absmin.z;
 
-			// adjust top to bypass blockages
-			for (float t = 0.0f; t <= length; t += inc) {
-				on = ladder->m_top - t * along;
+		// determine facing - assumes "normal" runged ladder
+		float xSize = entity->v.absmax.x - entity->v.absmin.x;
+		float ySize = entity->v.absmax.y - entity->v.absmin.y;
+		if (xSize > ySize) {
+			// ladder is facing north or south - determine which way
+			// "pull in" traceline from bottom and top in case ladder abuts floor and/or ceiling
+			const Vector from = ladder->m_bottom + Vector(0.0f, GenerationStepSize, GenerationStepSize);
+			const Vector to = ladder->m_top + Vector(0.0f, GenerationStepSize, -GenerationStepSize);
 
-				out = on;
-				AddDirectionVector(&out, ladder->m_dir, minLadderClearance);
+			UTIL_TraceLine(from, to, ignore_monsters, ENT(entity), &result);
 
-				UTIL_TraceLine(on, out, ignore_monsters, ENT(entity), &result);
+			if (result.flFraction != 1.0f || result.fStartSolid)
+				ladder->m_dir = NORTH;
+			else
+				ladder->m_dir = SOUTH;
+		} else {
+			// ladder is facing east or west - determine which way
+			const Vector from = ladder->m_bottom + Vector(GenerationStepSize, 0.0f, GenerationStepSize);
+			const Vector to = ladder->m_top + Vector(GenerationStepSize, 0.0f, -GenerationStepSize);
 
-				if (result.flFraction == 1.0f && !result.fStartSolid) {
-					// found viable ladder top
-					ladder->m_top = on;
-					break;
-				}
-			}
+			UTIL_TraceLine(from, to, ignore_monsters, ENT(entity), &result);
 
-			ladder->m_length = (ladder->m_top - ladder->m_bottom).Length();
+			if (result.flFraction != 1.0f || result.fStartSolid)
+				ladder->m_dir = WEST;
+			else
+				ladder->m_dir = EAST;
+		}
 
-			DirectionToVector2D(ladder->m_dir, &ladder->m_dirVector);
+		// adjust top and bottom of ladder to make sure they are reachable
+		// (cs_office has a crate right in front of the base of a ladder)
+		const Vector along = (ladder->m_top - ladder->m_bottom).Normalize();
+		const float length = along.Length();
+		Vector on, out;
+		constexpr float minLadderClearance = 32.0f;
 
-			ladder->m_entity = entity;
-			const float nearLadderRange = 75.0f;		// 50
+		// adjust bottom to bypass blockages
+		constexpr float inc = 10.0f;
+		for (float t = 0.0f; t <= length; t += inc) {
+			on = ladder->m_bottom + t * along;
 
-			//
-			// Find naviagtion area at bottom of ladder
-			//
+			out = on;
+			AddDirectionVector(&out, ladder->m_dir, minLadderClearance);
 
-			// get approximate postion of player on ladder
-			Vector center = ladder->m_bottom + Vector(0, 0, GenerationStepSize);
-			AddDirectionVector(&center, ladder->m_dir, HalfHumanWidth);
+			UTIL_TraceLine(on, out, ignore_monsters, ENT(entity), &result);
 
-			ladder->m_bottomArea = m_navAreaGrid.GetNearestNavArea(this, &center, true);
-			if (!ladder->m_bottomArea) {
-				ALERT(at_console, "ERROR: Unconnected ladder bottom at ( %g, %g, %g )\n", ladder->m_bottom.x, ladder->m_bottom.y, ladder->m_bottom.z);
-			} else {
-				// store reference to ladder in the area
-				ladder->m_bottomArea->AddLadderUp(ladder);
+			if (result.flFraction == 1.0f && !result.fStartSolid) {
+				// found viable ladder bottom
+				ladder->m_bottom = on;
+				break;
 			}
+		}
 
-			//
-			// Find adjacent navigation areas at the top of the ladder
-			//
+		// adjust top to bypass blockages
+		for (float t = 0.0f; t <= length; t += inc) {
+			on = ladder->m_top - t * along;
 
-			// get approximate postion of player on ladder
-			center = ladder->m_top + Vector(0, 0, GenerationStepSize);
-			AddDirectionVector(&center, ladder->m_dir, HalfHumanWidth);
+			out = on;
+			AddDirectionVector(&out, ladder->m_dir, minLadderClearance);
 
-			// find "ahead" area
-			ladder->m_topForwardArea = FindFirstAreaInDirection(&center, OppositeDirection(ladder->m_dir), nearLadderRange, 120.0f, entity);
-			if (ladder->m_topForwardArea == ladder->m_bottomArea)
-				ladder->m_topForwardArea = nullptr;
+			UTIL_TraceLine(on, out, ignore_monsters, ENT(entity), &result);
 
-			// find "left" area
-			ladder->m_topLeftArea = FindFirstAreaInDirection(&center, DirectionLeft(ladder->m_dir), nearLadderRange, 120.0f, entity);
-			if (ladder->m_topLeftArea == ladder->m_bottomArea)
-				ladder->m_topLeftArea = nullptr;
+			if (result.flFraction == 1.0f && !result.fStartSolid) {
+				// found viable ladder top
+				ladder->m_top = on;
+				break;
+			}
+		}
 
-			// find "right" area
-			ladder->m_topRightArea = FindFirstAreaInDirection(&center, DirectionRight(ladder->m_dir), nearLadderRange, 120.0f, entity);
-			if (ladder->m_topRightArea == ladder->m_bottomArea)
-				ladder->m_topRightArea = nullptr;
+		ladder->m_length = (ladder->m_top - ladder->m_bottom).Length();
+		DirectionToVector2D(ladder->m_dir, &ladder->m_dirVector);
+		ladder->m_entity = entity;
+	}
 
-			// find "behind" area - must look farther, since ladder is against the wall away from this area
-			ladder->m_topBehindArea = FindFirstAreaInDirection(&center, ladder->m_dir, 2.0f * nearLadderRange, 120.0f, entity);
-			if (ladder->m_topBehindArea == ladder->m_bottomArea)
-				ladder->m_topBehindArea = nullptr;
+	/**
+	 * Store a finished ladder in the areas it connects, and in the ladder list.
+	 */
+	void NavigationMap::AttachLadder(NavLadder* ladder) {
+		if (ladder->m_bottomArea)
+			ladder->m_bottomArea->AddLadderUp(ladder);
 
-			// can't include behind area, since it is not used when going up a ladder
-			if (!ladder->m_topForwardArea && !ladder->m_topLeftArea && !ladder->m_topRightArea)
-				ALERT(at_console, "ERROR: Unconnected ladder top at ( %g, %g, %g )\n", ladder->m_top.x, ladder->m_top.y, ladder->m_top.z);
+		for (NavArea* topArea : { ladder->m_topForwardArea, ladder->m_topLeftArea, ladder->m_topRightArea, ladder->m_topBehindArea }) {
+			if (topArea)
+				topArea->AddLadderDown(ladder);
+		}
 
-			// store reference to ladder in the area(s)
-			if (ladder->m_topForwardArea)
-				ladder->m_topForwardArea->AddLadderDown(ladder);
+		// add ladder to global list
+		m_navLadders.push_back(ladder);
+	}
 
-			if (ladder->m_topLeftArea)
-				ladder->m_topLeftArea->AddLadderDown(ladder);
+	namespace {
+		/// a finished ladder as stored in the nav cache
+		struct LadderRecord {
+			float absmin[3];									///< bounds of the entity, to tell whether the map still has this ladder
+			float absmax[3];
+			float top[3];
+			float bottom[3];
+			float length;										///< measured before the top is moved onto its area
+			std::uint32_t dir;
+			std::uint32_t areaID[5];							///< bottom, forward, left, right and behind areas, zero for none
+			std::uint32_t isDangling;
+		};
+
+		void StoreVector(float* out, const Vector& v) { out[0] = v.x; out[1] = v.y; out[2] = v.z; }
+		Vector LoadVector(const float* in) { return Vector(in[0], in[1], in[2]); }
+	}
 
-			if (ladder->m_topRightArea)
-				ladder->m_topRightArea->AddLadderDown(ladder);
+	void NavigationMap::SaveLadders(NavCache* cache) const {
+		std::vector<std::uint8_t> data(m_navLadders.size() * sizeof(LadderRecord));
+		std::size_t offset = 0;
+		for (auto ladder : m_navLadders) {
+			LadderRecord record{};
+			StoreVector(record.absmin, ladder->m_entity->v.absmin);
+			StoreVector(record.absmax, ladder->m_entity->v.absmax);
+			StoreVector(record.top, ladder->m_top);
+			StoreVector(record.bottom, ladder->m_bottom);
+			record.length = ladder->m_length;
+			record.dir = ladder->m_dir;
+
+			const NavArea* areas[5] = { ladder->m_bottomArea, ladder->m_topForwardArea, ladder->m_topLeftArea, ladder->m_topRightArea, ladder->m_topBehindArea };
+			for (int i = 0; i < 5; ++i)
+				record.areaID[i] = areas[i] ? areas[i]->m_id : 0;
+
+			record.isDangling = ladder->m_isDangling;
+			std::memcpy(data.data() + offset, &record, sizeof record);
+			offset += sizeof record;
+		}
+		cache->SetSection(NavCache::LADDER_SECTION, std::move(data));
+	}
 
-			if (ladder->m_topBehindArea)
-				ladder->m_topBehindArea->AddLadderDown(ladder);
+	/**
+	 * Rebuild the ladders from the cache, if it describes exactly the given entities.
+	 */
+	bool NavigationMap::LoadLadders(const NavCache& cache, const std::vector<edict_t*>& entities) {
+		const std::vector<std::uint8_t>* data = cache.GetSection(NavCache::LADDER_SECTION);
+		if (data == nullptr || data->size() != entities.size() * sizeof(LadderRecord))
+			return false;
 
-			// adjust top of ladder to highest connected area
-			float topZ = -99999.9f;
-			bool topAdjusted = false;
-			NavArea* topAreaList[4]{ ladder->m_topForwardArea,ladder->m_topLeftArea, ladder->m_topRightArea, ladder->m_topBehindArea };
+		std::vector<LadderRecord> records(entities.size());
+		if (!records.empty())
+			std::memcpy(records.data(), data->data(), data->size());
 
-			for (int a = 0; a < 4; ++a) {
-				NavArea* topArea = topAreaList[a];
-				if (topArea == nullptr)
-					continue;
+		for (std::size_t i = 0; i < records.size(); ++i) {
+			if (!(LoadVector(records[i].absmin) == entities[i]->v.absmin) || !(LoadVector(records[i].absmax) == entities[i]->v.absmax))
+				return false;
 
-				Vector close;
-				topArea->GetClosestPointOnArea(&ladder->m_top, &close);
-				if (topZ < close.z) {
-					topZ = close.z;
-					topAdjusted = true;
-				}
+			for (auto id : records[i].areaID) {
+				if (id != 0 && m_navAreaGrid.GetNavAreaByID(id) == nullptr)
+					return false;
 			}
+		}
 
-			if (topAdjusted)
-				ladder->m_top.z = topZ;
-
-			//
-			// Determine whether this ladder is "dangling" or not
-			// "Dangling" ladders are too high to go up
-			//
-			ladder->m_isDangling = false;
-			if (ladder->m_bottomArea) {
-				Vector bottomSpot;
-				ladder->m_bottomArea->GetClosestPointOnArea(&ladder->m_bottom, &bottomSpot);
-				if (ladder->m_bottom.z - bottomSpot.z > HumanHeight)
-					ladder->m_isDangling = true;
-			}
+		for (std::size_t i = 0; i < records.size(); ++i) {
+			const LadderRecord& record = records[i];
+			NavLadder* ladder = new NavLadder;
+			ladder->m_top = LoadVector(record.top);
+			ladder->m_bottom = LoadVector(record.bottom);
+			ladder->m_dir = static_cast<NavDirType>(record.dir);
+			ladder->m_length = record.length;
+			DirectionToVector2D(ladder->m_dir, &ladder->m_dirVector);
+			ladder->m_entity = entities[i];
 
-			// add ladder to global list
-			m_navLadders.push_back(ladder);
+			auto area = [this](std::uint32_t id) { return id != 0 ? m_navAreaGrid.GetNavAreaByID(id) : nullptr; };
+			ladder->m_bottomArea = area(record.areaID[0]);
+			ladder->m_topForwardArea = area(record.areaID[1]);
+			ladder->m_topLeftArea = area(record.areaID[2]);
+			ladder->m_topRightArea = area(record.areaID[3]);
+			ladder->m_topBehindArea = area(record.areaID[4]);
+			ladder->m_isDangling = record.isDangling != 0;
 
-			entity = FindEntityByClassname(entity, "func_ladder");
+			AttachLadder(ladder);
 		}
+		return true;
 	}
 
-	//--------------------------------------------------------------------------------------------------------------
-	/**
-	 * Load AI navigation data from a file
-	 */
-	bool NavigationMap::Load(const std::string& Path_To_Nav) {
-		// free previous navigation map data
-		// TODO: Destroy current navigation meshes.
-
-		if (FILE* fp = fopen(Path_To_Nav.c_str(), "rb"); fp != nullptr) {
-			Destroy();
-			NavArea::m_nextID = 1;
-
-			// check magic number
-			struct { std::uint32_t magic, version; } header;
-			fread(&header, sizeof header, 1, fp);
+	namespace {
+		/// an area merged away, as stored in the merged ID file
+		struct MergedIDRecord {
+			std::uint32_t id;
+			std::uint32_t mergedInto;							///< ID of the area that holds it now
+		};
+
+		struct MergedIDHeader {
+			std::uint32_t magic;
+			std::uint32_t version;
+			std::uint64_t fingerprint;							///< of the .nav file the IDs were merged into
+			std::uint32_t recordCount;
+		};
+
+		constexpr std::uint32_t Merged_ID_Magic = 0x4D5A4E43;	///< 'CNZM'
+		constexpr std::uint32_t Merged_ID_Version = 1;
+
+		/// read the IDs merged away before the .nav file with this fingerprint was saved; a file for another .nav is ignored
+		void ReadMergedIDs(const std::string& path, std::uint64_t fingerprint, std::unordered_map<std::uint32_t, std::uint32_t>* mergedIDs) {
+			FILE* fp = fopen(path.c_str(), "rb");
+			if (fp == nullptr)
+				return;
+
+			MergedIDHeader header{};
+			std::vector<MergedIDRecord> records;
+			if (fread(&header, sizeof header, 1, fp) == 1 && header.magic == Merged_ID_Magic && header.version == Merged_ID_Version && header.fingerprint == fingerprint) {
+				records.resize(header.recordCount);
+				if (!records.empty() && fread(records.data(), sizeof(MergedIDRecord), records.size(), fp) != records.size())
+					records.clear();
+			}
+			fclose(fp);
 
-			if (header.version >= 4) {
-				// get size of source bsp file and verify that the bsp hasn't changed
-				std::uint32_t saveBspSize{};
-				fread(&saveBspSize, sizeof(std::uint32_t), 1, fp);
+			for (auto& record : records)
+				mergedIDs->emplace(record.id, record.mergedInto);
+		}
 
-				// verify size
-				std::string bspFilename = std::format("maps\\{}.bsp", STRING(gpGlobals->mapname));
-				std::uint32_t bspSize = (std::uint32_t)GET_FILE_SIZE(bspFilename);
+		/// write the IDs merged away, under another name first so a failed write leaves the old file as it was
+		bool WriteMergedIDs(const std::string& path, std::uint64_t fingerprint, const std::unordered_map<std::uint32_t, std::uint32_t>& mergedIDs) {
+			std::vector<MergedIDRecord> records;
+			records.reserve(mergedIDs.size());
+			for (auto& [id, mergedInto] : mergedIDs)
+				records.push_back({ id, mergedInto });
+			std::sort(records.begin(), records.end(), [](const MergedIDRecord& a, const MergedIDRecord& b) { return a.id < b.id; });
+
+			const std::string Temporary_Path = path + ".tmp";
+			FILE* fp = fopen(Temporary_Path.c_str(), "wb");
+			if (fp == nullptr)
+				return false;
+
+			const MergedIDHeader Header{ Merged_ID_Magic, Merged_ID_Version, fingerprint, static_cast<std::uint32_t>(records.size()) };
+			bool ok = fwrite(&Header, sizeof Header, 1, fp) == 1;
+			ok = ok && fwrite(records.data(), sizeof(MergedIDRecord), records.size(), fp) == records.size();
+			ok = fclose(fp) == 0 && ok;
+
+			std::error_code error;
+			if (ok)
+				std::filesystem::rename(Temporary_Path, path, error);
+
+			std::filesystem::remove(Temporary_Path, error);
+			return ok && !error;
+		}
 
-				if (bspSize != saveBspSize) {
-					// this nav file is out of date for this bsp file
-					const char* msg = "*** WARNING ***\nThe AI navigation data is from a different version of this map.\nThe CPU players will likely not perform well.\n";
-					SERVER_PRINT("\n-----------------\n");
-					SERVER_PRINT(msg);
-					SERVER_PRINT("-----------------\n\n");
-				}
-			}
+		/// sizes of the records LoadMesh() keeps as they are, see NavigationMap::SetLazyDecoding()
+		constexpr std::size_t Spot_Record_Size = 17;			///< ID, position, flags
+		constexpr std::size_t Encounter_Record_Size = 11;		///< from ID and direction, to ID and direction, spot count
+		constexpr std::size_t Encounter_Spot_Record_Size = 5;	///< spot ID, parametric distance as a byte
 
-			// load Place directory
-			if (header.version >= 5) {
-				std::unordered_map<std::string, Place> place_id{
-					{"BombsiteA",1},
-					{"BombsiteB",2},
-					{"BombsiteC",3},
-					{"Hostages",4},
-					{"HostageRescueZone",5},
-					{"VipRescueZone",6},
-					{"CTSpawn",7},
-					{"TSpawn",8},
-					{"Bridge",9},
-					{"Middle",10},
-					{"House",11},
-					{"Apartment",12},
-					{"Apartments",13},
-					{"Market",14},
-					{"Sewers",15},
-					{"Tunnel",16},
-					{"Ducts",17},
-					{"Village",18},
-					{"Roof",19},
-					{"Upstairs",20},
-					{"Downstairs",21},
-					{"Basement",22},
-					{"Crawlspace",23},
-					{"Kitchen",24},
-					{"Inside",25},
-					{"Outside",26},
-					{"Tower",27},
-					{"WineCellar",28},
-					{"Garage",29},
-					{"Courtyard",30},
-					{"Water",31},
-					{"FrontDoor",32},
-					{"BackDoor",33},
-					{"SideDoor",34},
-					{"BackWay",35},
-					{"FrontYard",36},
-					{"BackYard",37},
-					{"SideYard",38},
-					{"Lobby",39},
-					{"Vault",40},
-					{"Elevator",41},
-					{"DoubleDoors",42},
-					{"SecurityDoors",43},
-					{"LongHall",44},
-					{"SideHall",45},
-					{"FrontHall",46},
-					{"BackHall",47},
-					{"MainHall",48},
-					{"FarSide",49},
-					{"Windows",50},
-					{"Window",51},
-					{"Attic",52},
-					{"StorageRoom",53},
-					{"ProjectorRoom",54},
-					{"MeetingRoom",55},
-					{"ConferenceRoom",56},
-					{"ComputerRoom",57},
-					{"BigOffice",58},
-					{"LittleOffice",59},
-					{"Dumpster",60},
-					{"Airplane",61},
-					{"Underground",62},
-					{"Bunker",63},
-					{"Mines",64},
-					{"Front",65},
-					{"Back",66},
-					{"Rear",67},
-					{"Side",68},
-					{"Ramp",69},
-					{"Underpass",70},
-					{"Overpass",71},
-					{"Stairs",72},
-					{"Ladder",73},
-					{"Gate",74},
-					{"GateHouse",75},
-					{"LoadingDock",76},
-					{"GuardHouse",77},
-					{"Entrance",78},
-					{"VendingMachines",79},
-					{"Loft",80},
-					{"Balcony",81},
-					{"Alley",82},
-					{"BackAlley",83},
-					{"SideAlley",84},
-					{"FrontRoom",85},
-					{"BackRoom",86},
-					{"SideRoom",87},
-					{"Crates",88},
-					{"Truck",89},
-					{"Bedroom",90},
-					{"FamilyRoom",91},
-					{"Bathroom",92},
-					{"LivingRoom",93},
-					{"Den",94},
-					{"Office",95},
-					{"Atrium",96},
-					{"Entryway",97},
-					{"Foyer",98},
-					{"Stairwell",99},
-					{"Fence",100},
-					{"Deck",101},
-					{"Porch",102},
-					{"Patio",103},
-					{"Wall",104}
-				};
+		template<typename T>
+		T ReadRecordField(const std::uint8_t* bytes) noexcept {
+			T value;
+			std::memcpy(&value, bytes, sizeof value);
+			return value;
+		}
 
-				// read number of entries
-				PlaceDirectory::EntryType count;
-				fread(&count, sizeof(PlaceDirectory::EntryType), 1, fp);
-				m_placeDirectory.Reserve(count);
+		/// the smallest area record: ID, flags, extent, corner heights, four connection counts, and the other counts
+		constexpr std::size_t Min_Area_Record_Size = 4 + 1 + sizeof(Extent) + 8 + 4 * 4 + 1 + 1 + 4 + 2;
 
-				// read each entry
-				for (uint32_t i = 0; i < count; ++i) {
-					std::uint16_t len{};
-					fread(&len, sizeof(std::uint16_t), 1, fp);
+		bool ReadWholeFile(const std::string& path, std::vector<std::uint8_t>* bytes) {
+			FILE* fp = fopen(path.c_str(), "rb");
+			if (fp == nullptr)
+				return false;
 
-					char placeName[256];
-					fread(placeName, sizeof(char), len, fp);
+			std::error_code error;
+			bytes->resize(static_cast<std::size_t>(std::filesystem::file_size(path, error)));
+			bytes->resize(error ? 0 : fread(bytes->data(), 1, bytes->size(), fp));
+			fclose(fp);
+			return true;
+		}
 
-					if (auto it = place_id.find(placeName); it != place_id.end()) {
-						m_placeDirectory.AddPlace(it->second);
-					}
-				}
+		/**
+		 * Reads the fields of a .nav file held in memory. Fields past the end read as zero, and IsPastEnd() tells.
+		 */
+		class RecordReader {
+			const std::vector<std::uint8_t>& m_bytes;
+			std::size_t m_offset;
+
+		public:
+			explicit RecordReader(const std::vector<std::uint8_t>& bytes, std::size_t offset = 0) : m_bytes(bytes), m_offset(offset) { }
+
+			template<typename T>
+			T Read() noexcept {
+				T value{};
+				if (m_offset + sizeof(T) <= m_bytes.size())
+					std::memcpy(&value, m_bytes.data() + m_offset, sizeof value);
+				m_offset += sizeof(T);
+				return value;
 			}
 
-			// get number of areas
-			std::uint32_t count{};
-			fread(&count, sizeof(std::uint32_t), 1, fp);
-
-			Extent extent;
-			extent.lo.x = 9999999999.9f;
-			extent.lo.y = 9999999999.9f;
-			extent.hi.x = -9999999999.9f;
-			extent.hi.y = -9999999999.9f;
-
-			// load the areas and compute total extent
-			for (std::uint32_t i = 0; i < count; ++i) {
-				NavArea* area = new NavArea();
-				// load ID
-				fread(&area->m_id, sizeof(std::uint32_t), 1, fp);
-
-				// update nextID to avoid collisions
-				if (area->m_id >= NavArea::m_nextID)
-					NavArea::m_nextID = area->m_id + 1;
-
-				// load attribute flags
-				fread(&area->m_attributeFlags, sizeof(std::uint8_t), 1, fp);
-
-				// load extent of area
-				fread(&area->m_extent, sizeof(Extent), 1, fp);
-
-				area->m_center.x = (area->m_extent.lo.x + area->m_extent.hi.x) / 2.0f;
-				area->m_center.y = (area->m_extent.lo.y + area->m_extent.hi.y) / 2.0f;
-				area->m_center.z = (area->m_extent.lo.z + area->m_extent.hi.z) / 2.0f;
-
-				// load heights of implicit corners
-				fread(&area->m_neZ, sizeof(float), 1, fp);
-				fread(&area->m_swZ, sizeof(float), 1, fp);
-
-				// load connections (IDs) to adjacent areas
-				// in the enum order NORTH, EAST, SOUTH, WEST
-				for (int d = 0; d < NUM_DIRECTIONS; d++) {
-					// load number of connections for this direction
-					std::uint32_t count{};
-					fread(&count, sizeof(std::uint32_t), 1, fp);
-					for (std::uint32_t j = 0; j < count; ++j) {
-						NavConnect connect{};
-						fread(&connect.id, sizeof(std::uint32_t), 1, fp);
-						area->m_connect[d].push_back(connect);
-					}
-				}
-
-				//
-				// Load hiding spots
-				//
+			/// a string of 'length' bytes, up to its terminating null
+			std::string_view ReadString(std::size_t length) noexcept {
+				const std::size_t Available = m_offset < m_bytes.size() ? (std::min)(length, m_bytes.size() - m_offset) : 0;
+				const auto Text = reinterpret_cast<const char*>(m_bytes.data() + (std::min)(m_offset, m_bytes.size()));
+				m_offset += length;
+				return { Text, strnlen(Text, Available) };
+			}
 
-				// load number of hiding spots
-				std::uint8_t hidingSpotCount{};
-				fread(&hidingSpotCount, sizeof(std::uint8_t), 1, fp);
+			void Skip(std::size_t size) noexcept { m_offset += size; }
+			void Seek(std::size_t offset) noexcept { m_offset = offset; }
+			std::size_t GetOffset() const noexcept { return m_offset; }
+			bool IsPastEnd() const noexcept { return m_offset > m_bytes.size(); }
+		};
+
+		/// where the parts of an area record are in the file, found without decoding it
+		struct AreaRecordLayout {
+			std::size_t start;
+			std::size_t spots;									///< first hiding spot record
+			std::size_t encounters;								///< first encounter record
+			std::size_t place;									///< place entry, the last field
+			std::uint32_t encounterCount;
+			std::uint8_t spotCount;
+		};
+
+		AreaRecordLayout ScanAreaRecord(RecordReader* reader, std::uint32_t version) {
+			AreaRecordLayout layout{};
+			layout.start = reader->GetOffset();
+
+			// ID, attribute flags, extent, heights of implicit corners
+			reader->Skip(4 + 1 + sizeof(Extent) + 2 * sizeof(float));
+			for (int d = 0; d < NUM_DIRECTIONS; ++d)
+				reader->Skip(reader->Read<std::uint32_t>() * sizeof(std::uint32_t));
+
+			layout.spotCount = reader->Read<std::uint8_t>();
+			layout.spots = reader->GetOffset();
+			reader->Skip(layout.spotCount * (version == 1 ? sizeof(Vector) : Spot_Record_Size));
+
+			// here, prev, how, next, how
+			reader->Skip(reader->Read<std::uint8_t>() * (3 * sizeof(std::uint32_t) + 2));
+
+			layout.encounterCount = reader->Read<std::uint32_t>();
+			layout.encounters = reader->GetOffset();
+			for (std::uint32_t e = 0; e < layout.encounterCount && !reader->IsPastEnd(); ++e) {
+				reader->Skip(Encounter_Record_Size - 1);
+				reader->Skip(reader->Read<std::uint8_t>() * Encounter_Spot_Record_Size);
+			}
 
-				if (header.version == 1) {
-					// load simple vector array
-					Vector pos;
-					for (int h = 0; h < hidingSpotCount; ++h) {
-						fread(&pos, sizeof(float), 3, fp);
+			layout.place = reader->GetOffset();
+			reader->Skip(sizeof(std::uint16_t));
+			return layout;
+		}
 
-						// create new hiding spot and put on master list
-						HidingSpot* spot = new HidingSpot(this, &pos, HidingSpot::IN_COVER);
-						area->hiding_spots.push_back(spot);
-					}
-				} else {
-					// load HidingSpot objects for this area
-					for (int h = 0; h < hidingSpotCount; ++h) {
-						// create new hiding spot and put on master list
-						HidingSpot* spot = new HidingSpot(this);
-						fread(&spot->m_id, sizeof(unsigned int), 1, fp);
-						fread(&spot->m_pos, sizeof(Vector), 1, fp);
-						fread(&spot->m_flags, sizeof(unsigned char), 1, fp);
-
-						// update next ID to avoid ID collisions by later spots
-						if (spot->m_id >= spot->m_nextID)
-							spot->m_nextID = spot->m_id + 1;
-						area->hiding_spots.push_back(spot);
-					}
-				}
+		/**
+		 * Decode one area record, leaving the IDs it refers to for Validate() to resolve. Touches nothing shared, so
+		 * records can be decoded on any thread; the spots are left for the caller to add to the map.
+		 */
+		NavArea* DecodeAreaRecord(const std::vector<std::uint8_t>& file, const AreaRecordLayout& layout, std::uint32_t version, bool lazy, const PlaceDirectory& places) {
+			RecordReader reader(file, layout.start);
+			NavArea* area = new NavArea();
+
+			// load ID
+			area->m_id = reader.Read<std::uint32_t>();
+
+			// load attribute flags
+			area->m_attributeFlags = reader.Read<std::uint8_t>();
+
+			// load extent of area
+			area->m_extent = reader.Read<Extent>();
+
+			area->m_center.x = (area->m_extent.lo.x + area->m_extent.hi.x) / 2.0f;
+			area->m_center.y = (area->m_extent.lo.y + area->m_extent.hi.y) / 2.0f;
+			area->m_center.z = (area->m_extent.lo.z + area->m_extent.hi.z) / 2.0f;
+
+			// load heights of implicit corners
+			area->m_neZ = reader.Read<float>();
+			area->m_swZ = reader.Read<float>();
+
+			// load connections (IDs) to adjacent areas
+			// in the enum order NORTH, EAST, SOUTH, WEST
+			for (int d = 0; d < NUM_DIRECTIONS; d++) {
+				const auto Count = reader.Read<std::uint32_t>();
+				for (std::uint32_t j = 0; j < Count; ++j)
+					area->m_connect[d].push_back({ reader.Read<std::uint32_t>() });
+			}
 
-				//
-				// Load number of approach areas
-				//
-				fread(&area->m_approachCount, sizeof(std::uint8_t), 1, fp);
-
-				// load approach area info (IDs)
-				std::uint8_t type;
-				for (int a = 0; a < area->m_approachCount; ++a) {
-					fread(&area->m_approach[a].here.id, sizeof(std::uint32_t), 1, fp);
-					fread(&area->m_approach[a].prev.id, sizeof(std::uint32_t), 1, fp);
-					fread(&type, sizeof(std::uint8_t), 1, fp);
-					area->m_approach[a].prevToHereHow = (NavTraverseType)type;
-
-					fread(&area->m_approach[a].next.id, sizeof(std::uint32_t), 1, fp);
-					fread(&type, sizeof(std::uint8_t), 1, fp);
-					area->m_approach[a].hereToNextHow = (NavTraverseType)type;
+			//
+			// Load hiding spots
+			//
+			reader.Seek(layout.spots);
+			if (lazy) {
+				reader.Skip(layout.spotCount * Spot_Record_Size);
+			} else if (version == 1) {
+				// load simple vector array; the IDs are given out in file order by the caller
+				for (int h = 0; h < layout.spotCount; ++h) {
+					HidingSpot* spot = new HidingSpot();
+					spot->m_pos = reader.Read<Vector>();
+					spot->m_flags = HidingSpot::IN_COVER;
+					area->hiding_spots.push_back(spot);
 				}
-				//
-				// Load encounter paths for this area
-				//
-				std::uint32_t count;
-				fread(&count, sizeof(std::uint32_t), 1, fp);
-
-				for (std::uint32_t e = 0; e < count; ++e) {
-					SpotEncounter encounter;
-					fread(&encounter.from.id, sizeof(std::uint32_t), 1, fp);
-					std::uint8_t dir;
-					fread(&dir, sizeof(std::uint8_t), 1, fp);
-					encounter.fromDir = static_cast<NavDirType>(dir);
-
-					fread(&encounter.to.id, sizeof(std::uint32_t), 1, fp);
-					fread(&dir, sizeof(std::uint8_t), 1, fp);
-					encounter.toDir = static_cast<NavDirType>(dir);
-
-					// read list of spots along this path
-					std::uint8_t spotCount;
-					fread(&spotCount, sizeof(std::uint8_t), 1, fp);
-
-					SpotOrder order;
-					for (int s = 0; s < spotCount; ++s) {
-						fread(&order.id, sizeof(std::uint32_t), 1, fp);
-
-						std::uint8_t t;
-						fread(&t, sizeof(std::uint8_t), 1, fp);
-						order.t = (float)t / 255.0f;
-						encounter.spotList.push_back(order);
-					}
-					area->encounter_spots.push_back(encounter);
+			} else {
+				for (int h = 0; h < layout.spotCount; ++h) {
+					HidingSpot* spot = new HidingSpot();
+					spot->m_id = reader.Read<std::uint32_t>();
+					spot->m_pos = reader.Read<Vector>();
+					spot->m_flags = reader.Read<std::uint8_t>();
+					area->hiding_spots.push_back(spot);
 				}
-
-				//
-				// Load Place data
-				//
-				std::uint16_t entry{};
-				fread(&entry, sizeof(entry), 1, fp);
-
-				// convert entry to actual Place
-				area->m_place = m_placeDirectory.EntryToPlace(entry);
-				m_areas.push_back(area);
-
-				const Extent* areaExtent = &area->m_extent;
-
-				if (areaExtent->lo.x < extent.lo.x)
-					extent.lo.x = areaExtent->lo.x;
-				if (areaExtent->lo.y < extent.lo.y)
-					extent.lo.y = areaExtent->lo.y;
-				if (areaExtent->hi.x > extent.hi.x)
-					extent.hi.x = areaExtent->hi.x;
-				if (areaExtent->hi.y > extent.hi.y)
-					extent.hi.y = areaExtent->hi.y;
 			}
 
-			// add the areas to the grid
-			m_navAreaGrid.Initialize(extent.lo.x, extent.hi.x, extent.lo.y, extent.hi.y);
-
-			for (auto& area : m_areas) {
-				m_navAreaGrid.AddNavArea(area);
+			//
+			// Load number of approach areas
+			//
+			area->m_approachCount = (std::min)(reader.Read<std::uint8_t>(), static_cast<std::uint8_t>(NavArea::MAX_APPROACH_AREAS));
+
+			// load approach area info (IDs)
+			for (int a = 0; a < area->m_approachCount; ++a) {
+				area->m_approach[a].here.index = reader.Read<std::uint32_t>();
+				area->m_approach[a].prev.index = reader.Read<std::uint32_t>();
+				area->m_approach[a].prevToHereHow = static_cast<NavTraverseType>(reader.Read<std::uint8_t>());
+				area->m_approach[a].next.index = reader.Read<std::uint32_t>();
+				area->m_approach[a].hereToNextHow = static_cast<NavTraverseType>(reader.Read<std::uint8_t>());
 			}
-			// allow areas to connect to each other, etc
-			for (auto& area : m_areas) {
-				Validate(area);
+
+			//
+			// Load encounter paths for this area
+			//
+			reader.Seek(layout.encounters);
+			for (std::uint32_t e = 0; e < layout.encounterCount && !lazy; ++e) {
+				SpotEncounter encounter;
+				encounter.from.index = reader.Read<std::uint32_t>();
+				encounter.fromDir = static_cast<NavDirType>(reader.Read<std::uint8_t>());
+				encounter.to.index = reader.Read<std::uint32_t>();
+				encounter.toDir = static_cast<NavDirType>(reader.Read<std::uint8_t>());
+
+				// read list of spots along this path
+				const auto Spot_Count = reader.Read<std::uint8_t>();
+				for (int s = 0; s < Spot_Count; ++s) {
+					SpotOrder order;
+					order.spot = reader.Read<std::uint32_t>();
+					order.t = (float)reader.Read<std::uint8_t>() / 255.0f;
+					encounter.spotList.push_back(order);
+				}
+				area->encounter_spots.push_back(std::move(encounter));
 			}
 
 			//
-			// Set up all the ladders
+			// Load Place data
 			//
-			BuildLadders();
+			reader.Seek(layout.place);
+			area->m_place = places.EntryToPlace(reader.Read<std::uint16_t>());
+			return area;
+		}
 
-			fclose(fp);
-			return true;
-		} else {
-			return false;
+		constexpr std::uint32_t Nav_Magic = 0xFEEDFACE;
+		constexpr std::uint32_t Nav_Version = 5;				///< the version Save() writes
+
+		/// distance of (x, y) along a Hilbert curve filling a 65536 x 65536 grid
+		std::uint32_t GetHilbertKey(std::uint32_t x, std::uint32_t y) noexcept {
+			constexpr std::uint32_t Last = 0xFFFF;
+			std::uint32_t key = 0;
+			for (std::uint32_t s = 0x8000; s > 0; s >>= 1) {
+				const std::uint32_t Rx = (x & s) != 0;
+				const std::uint32_t Ry = (y & s) != 0;
+				key += s * s * ((3 * Rx) ^ Ry);
+
+				// rotate the quadrant so the curve stays continuous
+				if (Ry == 0) {
+					if (Rx == 1) {
+						x = Last - x;
+						y = Last - y;
+					}
+					std::swap(x, y);
+				}
+			}
+			return key;
 		}
+	}
 
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * Load AI navigation data from a file
+	 */
+	bool NavigationMap::Load(const std::string& Path_To_Nav, EngineQueue* engine) {
+		return LoadMesh(Path_To_Nav, engine) && AttachToLevel(engine);
 	}
 
-	void NavigationMap::Destroy() {
-		// remove each element of the list and delete them
-		while (!m_areas.empty()) {
-			auto area = m_areas.front();
-			m_areas.pop_front();
-			delete area;
+	/**
+	 * Read the areas, places and hiding spots from the file and connect them, without touching the level.
+	 * The area records vary in length, so a serial pass finds where each one starts; they are then decoded and
+	 * resolved in parallel, each into its own slot, so the result does not depend on how many threads ran.
+	 */
+	bool NavigationMap::LoadMesh(const std::string& Path_To_Nav, EngineQueue* engine) {
+		std::vector<std::uint8_t> file;
+		if (!ReadWholeFile(Path_To_Nav, &file))
+			return false;
+
+		// free previous navigation map data
+		Destroy();
+		NavArea::m_nextID = 1;
+		m_engine = engine;
+
+		// check magic number
+		RecordReader reader(file);
+		reader.Read<std::uint32_t>();
+		const auto Version = reader.Read<std::uint32_t>();
+
+		if (Version >= 4) {
+			// get size of source bsp file, verified against the level in AttachToLevel()
+			m_savedBspSize = reader.Read<std::uint32_t>();
 		}
 
-		// destroy ladder representations
-		DestroyLadders();
+		// load Place directory
+		if (Version >= 5) {
+			// read number of entries
+			const auto Count = reader.Read<PlaceDirectory::EntryType>();
+			m_placeDirectory.Reserve(Count);
 
-		// destroy all hiding spots
-		DestroyHidingSpots();
-		// reset the grid
-		m_navAreaGrid.Reset();
-	}
+			// read each entry; a name we do not know still takes its entry, as no place
+			for (std::uint32_t i = 0; i < Count; ++i) {
+				const auto Length = reader.Read<std::uint16_t>();
+				m_placeDirectory.AddEntry(FindPlace(reader.ReadString(Length)));
+			}
+		}
 
-	void NavigationMap::Validate(NavArea* area) {
-		// connect areas together
-		for (int d = 0; d < NUM_DIRECTIONS; d++) {
-			for (auto connection = area->m_connect[d].begin(); connection != area->m_connect[d].end(); ++connection) {
-				NavConnect* connect = &(*connection);
+		// get number of areas
+		const auto Count = reader.Read<std::uint32_t>();
 
-				unsigned int id = connect->id;
-				connect->area = m_navAreaGrid.GetNavAreaByID(id);
-				if (id && connect->area == nullptr) {
-					SERVER_PRINT("ERROR: Corrupt navigation data. Cannot connect Navigation Areas.\n");
-				}
+		// Phase 1: find where each area record starts, and where its hiding spots and encounters are
+		std::vector<AreaRecordLayout> layouts;
+		layouts.reserve((std::min)(Count, static_cast<std::uint32_t>(file.size() / Min_Area_Record_Size)));
+		for (std::uint32_t i = 0; i < Count; ++i) {
+			const AreaRecordLayout Layout = ScanAreaRecord(&reader, Version);
+			if (reader.IsPastEnd()) {
+				Print("ERROR: Corrupt navigation data. The file ends in the middle of the areas.\n");
+				break;
 			}
+			layouts.push_back(Layout);
 		}
 
-		// resolve approach area IDs
-		for (int a = 0; a < area->m_approachCount; ++a) {
-			area->m_approach[a].here.area = m_navAreaGrid.GetNavAreaByID(area->m_approach[a].here.id);
-			if (area->m_approach[a].here.id && area->m_approach[a].here.area == nullptr) {
-				SERVER_PRINT("ERROR: Corrupt navigation data. Missing Approach Area (here).\n");
+		// Phase 2: decode the records, each into its own area
+		// version 1 spots have no IDs for encounters to refer to, so they are always decoded
+		const bool Lazy = m_lazyDecoding && Version >= 2;
+		std::vector<NavArea*> areas(layouts.size());
+		std::vector<std::uint32_t> order(layouts.size());
+		std::iota(order.begin(), order.end(), 0u);
+		std::for_each(std::execution::par, order.begin(), order.end(), [&](std::uint32_t i) {
+			areas[i] = DecodeAreaRecord(file, layouts[i], Version, Lazy, m_placeDirectory);
+		});
+		m_areas.assign(areas.begin(), areas.end());
+
+		// in file order, so IDs and spot indices come out as if the file had been read in one pass; areas made on
+		// other threads gave out IDs from their counters, so this one starts over
+		NavArea::m_nextID = 1;
+		std::vector<std::pair<NavArea*, LazyRecord>> lazyRecords;
+		for (std::uint32_t i = 0; i < areas.size(); ++i) {
+			NavArea* area = areas[i];
+
+			// update nextID to avoid collisions
+			if (area->m_id >= NavArea::m_nextID)
+				NavArea::m_nextID = area->m_id + 1;
+
+			for (auto& spot : area->hiding_spots) {
+				if (Version == 1)
+					spot->m_id = HidingSpot::m_nextID++;
+				else if (spot->m_id >= HidingSpot::m_nextID)
+					spot->m_nextID = spot->m_id + 1;
+				AddHidingSpots(spot);
 			}
 
-			area->m_approach[a].prev.area = m_navAreaGrid.GetNavAreaByID(area->m_approach[a].prev.id);
-			if (area->m_approach[a].prev.id && area->m_approach[a].prev.area == nullptr) {
-				SERVER_PRINT("ERROR: Corrupt navigation data. Missing Approach Area (prev).\n");
+			if (Lazy) {
+				// only the records are kept, until GetHidingSpots() or GetSpotEncounters() is asked for them
+				auto keep = [&](std::size_t offset, std::size_t size) {
+					const auto Kept = static_cast<std::uint32_t>(m_lazyBytes.size());
+					m_lazyBytes.insert(m_lazyBytes.end(), file.begin() + offset, file.begin() + offset + size);
+					return Kept;
+				};
+				const AreaRecordLayout& Layout = layouts[i];
+				LazyRecord record{};
+				record.spotCount = Layout.spotCount;
+				record.spotOffset = keep(Layout.spots, Layout.spotCount * Spot_Record_Size);
+				record.encounterCount = Layout.encounterCount;
+				record.encounterOffset = keep(Layout.encounters, Layout.place - Layout.encounters);
+				lazyRecords.emplace_back(area, record);
 			}
+		}
 
-			area->m_approach[a].next.area = m_navAreaGrid.GetNavAreaByID(area->m_approach[a].next.id);
-			if (area->m_approach[a].next.id && area->m_approach[a].next.area == nullptr) {
-				SERVER_PRINT("ERROR: Corrupt navigation data. Missing Approach Area (next).\n");
-			}
+		// add the areas to the grid
+		BuildGrid();
+		// allow areas to connect to each other, etc
+		IndexAreas();
+
+		// Phase 3: resolve the IDs each area refers to; every area only writes to itself
+		IndexSpotIDs();
+		std::vector<std::uint8_t> errors(GetAreaCount());
+		std::for_each(std::execution::par, m_areaByIndex.begin(), m_areaByIndex.end(), [this, &errors](NavArea* area) {
+			errors[area->m_index] = Validate(area);
+		});
+		PrintValidationErrors(std::reduce(errors.begin(), errors.end(), std::uint8_t{}, std::bit_or<>()));
+
+		OrderAreas();
+		m_placeIndex.Build(*this);
+		if (Lazy)
+			IndexLazyRecords(lazyRecords);
+		else
+			std::vector<std::pair<std::uint32_t, std::uint32_t>>().swap(m_spotIndexByID);
+
+		// ladders are cached next to the .nav file, since building them takes a lot of traces
+		m_path = Path_To_Nav;
+		m_fingerprint = FingerprintData(file);
+		m_cache = std::make_unique<NavCache>(NavCache::GetPathFor(Path_To_Nav), m_fingerprint);
+		m_cache->Read();
+
+		// IDs of the areas merged away before the file was saved, see MergeAreas()
+		ReadMergedIDs(GetMergedIDPathFor(Path_To_Nav), m_fingerprint, &m_mergedIDs);
+
+		std::error_code error;
+		m_fileSize = std::filesystem::file_size(Path_To_Nav, error);
+		m_fileTime = std::filesystem::last_write_time(Path_To_Nav, error);
+
+		m_engine = nullptr;
+		return true;
+	}
+
+	bool NavigationMap::Save(const std::string& Path_To_Nav) const {
+		// written under another name and renamed into place, so a failed save leaves the old file as it was
+		const std::string Temporary_Path = Path_To_Nav + ".tmp";
+		FILE* fp = fopen(Temporary_Path.c_str(), "wb");
+		if (fp == nullptr)
+			return false;
+
+		bool ok = true;
+		auto write = [fp, &ok](const auto& value) { ok = ok && fwrite(&value, sizeof value, 1, fp) == 1; };
+		auto areaID = [this](NavConnect connect) { const NavArea* area = GetArea(connect); return area != nullptr ? area->m_id : 0u; };
+		DecodeAll();
+
+		write(Nav_Magic);
+		write(Nav_Version);
+		write(m_savedBspSize);
+
+		// only the places in use go in the directory, like the game's own editor does
+		PlaceDirectory directory;
+		for (auto& area : m_areaByIndex)
+			directory.AddPlace(area->m_place);
+
+		write(directory.GetEntryCount());
+		for (PlaceDirectory::EntryType entry = 1; entry <= directory.GetEntryCount(); ++entry) {
+			const std::string_view Name = GetPlaceName(directory.EntryToPlace(entry));
+			const auto Length = static_cast<std::uint16_t>(Name.size() + 1);
+			write(Length);
+			ok = ok && fwrite(Name.data(), 1, Length, fp) == Length;
 		}
 
-		// resolve spot encounter IDs
-		for (auto spotIter = area->encounter_spots.begin(); spotIter != area->encounter_spots.end(); ++spotIter) {
-			SpotEncounter* e = &(*spotIter);
-			e->from.area = m_navAreaGrid.GetNavAreaByID(e->from.id);
-			if (e->from.area  == nullptr) {
-				SERVER_PRINT("ERROR: Corrupt navigation data. Missing \"from\" Navigation Area for Encounter Spot.\n");
+		write(GetAreaCount());
+		for (auto& area : m_areaByIndex) {
+			write(area->m_id);
+			write(area->m_attributeFlags);
+			write(area->m_extent);
+			write(area->m_neZ);
+			write(area->m_swZ);
+
+			for (auto& connections : area->m_connect) {
+				write(static_cast<std::uint32_t>(connections.size()));
+				for (auto& connect : connections)
+					write(areaID(connect));
 			}
 
-			e->to.area = m_navAreaGrid.GetNavAreaByID(e->to.id);
-			if (e->to.area == nullptr) {
-				SERVER_PRINT("ERROR: Corrupt navigation data. Missing \"to\" Navigation Area for Encounter Spot.\n");
+			write(static_cast<std::uint8_t>(area->hiding_spots.size()));
+			for (auto& spot : area->hiding_spots) {
+				write(spot->m_id);
+				write(spot->m_pos);
+				write(spot->m_flags);
 			}
 
-			if (e->from.area && e->to.area) {
-				// compute path
-				float halfWidth;
-				area->ComputePortal(e->to.area, e->toDir, &e->path.to, &halfWidth);
-				area->ComputePortal(e->from.area, e->fromDir, &e->path.from, &halfWidth);
-
-				const float eyeHeight = HalfHumanHeight;
-				e->path.from.z = e->from.area->GetZ(&e->path.from) + eyeHeight;
-				e->path.to.z = e->to.area->GetZ(&e->path.to) + eyeHeight;
+			write(area->m_approachCount);
+			for (int a = 0; a < area->m_approachCount; ++a) {
+				const NavArea::ApproachInfo& approach = area->m_approach[a];
+				write(areaID(approach.here));
+				write(areaID(approach.prev));
+				write(static_cast<std::uint8_t>(approach.prevToHereHow));
+				write(areaID(approach.next));
+				write(static_cast<std::uint8_t>(approach.hereToNextHow));
 			}
 
-			// resolve HidingSpot IDs
-			for (auto oiter = e->spotList.begin(); oiter != e->spotList.end(); ++oiter) {
-				SpotOrder* order = &(*oiter);
-
-				order->spot = GetHidingSpotByID(order->id);
-				if (order->spot == nullptr) {
-					SERVER_PRINT("ERROR: Corrupt navigation data. Missing Hiding Spot\n");
+			write(static_cast<std::uint32_t>(area->encounter_spots.size()));
+			for (auto& e : area->encounter_spots) {
+				write(areaID(e.from));
+				write(static_cast<std::uint8_t>(e.fromDir));
+				write(areaID(e.to));
+				write(static_cast<std::uint8_t>(e.toDir));
+
+				write(static_cast<std::uint8_t>(e.spotList.size()));
+				for (auto& order : e.spotList) {
+					const HidingSpot* spot = GetHidingSpot(order);
+					write(spot != nullptr ? spot->m_id : 0u);
+					write(static_cast<std::uint8_t>(order.t * 255.0f + 0.5f));
 				}
 			}
+
+			write(directory.GetEntry(area->m_place));
 		}
+		ok = fclose(fp) == 0 && ok;
 
-		// build overlap list
-		/// @todo Optimize this
-		for (auto oiter = m_areas.begin(); oiter != m_areas.end(); ++oiter) {
-			NavArea* area2 = *oiter;
+		std::error_code error;
+		if (ok)
+			std::filesystem::rename(Temporary_Path, Path_To_Nav, error);
 
-			if (area2 == area)
-				continue;
+		const bool Saved = ok && !error;
+		std::filesystem::remove(Temporary_Path, error);
+		if (!Saved)
+			return false;
 
-			if (area->IsOverlapping(area2))
-				area->m_overlapList.push_back(area2);
+		// the IDs of merged areas are not part of the .nav format, and unlike the nav cache they cannot be rebuilt,
+		// so they get a file of their own next to it
+		const std::string Merged_ID_Path = GetMergedIDPathFor(Path_To_Nav);
+		if (m_mergedIDs.empty()) {
+			std::filesystem::remove(Merged_ID_Path, error);
+			return true;
 		}
+		return WriteMergedIDs(Merged_ID_Path, FingerprintFile(Path_To_Nav), m_mergedIDs);
 	}
 
-	/**
-	 * Clear the grid
-	 */
-	void NavAreaGrid::Reset(void) {
-		if (m_grid)
-			delete[] m_grid;
+	namespace {
+		/// how far the corners of the areas in the file may be from the surface of the area merging them
+		constexpr float Merge_Height_Tolerance = 1.0f;
 
-		m_grid = nullptr;
-		m_gridSizeX = 0;
-		m_gridSizeY = 0;
+		/// how far apart the sides of two areas may be and still line up
+		constexpr float Merge_Side_Tolerance = 0.01f;
 
-		// clear the hash table
-		for (int i = 0; i < HASH_TABLE_SIZE; ++i)
-			m_hashTable[i] = nullptr;
+		/// the .nav file stores the hiding spot count of an area in a byte
+		constexpr std::size_t Max_Area_Hiding_Spots = 255;
 
-		m_areaCount = 0;
-	}
+		/// the corners of an area, with their heights
+		std::array<Vector, NUM_CORNERS> GetCorners(const NavArea* area) {
+			const Extent& Bounds = area->m_extent;
+			return { Bounds.lo, Vector(Bounds.hi.x, Bounds.lo.y, area->m_neZ), Bounds.hi, Vector(Bounds.lo.x, Bounds.hi.y, area->m_swZ) };
+		}
+
+		/// add the corners of an area being merged in, each shared corner once
+		void AddCorners(std::vector<Vector>* corners, const std::vector<Vector>& added) {
+			corners->insert(corners->end(), added.begin(), added.end());
+			std::sort(corners->begin(), corners->end(), [](const Vector& a, const Vector& b) {
+				return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+			});
+			corners->erase(std::unique(corners->begin(), corners->end()), corners->end());
+		}
+
+		/**
+		 * Give 'area' the shape of itself and 'other', on side 'dir' of it, if together they make a rectangle whose
+		 * surface goes through the corners of every area they were merged from, given by 'areaCorners' and
+		 * 'otherCorners'; checking only their current corners would let a curved floor drift away one small step at
+		 * a time. Return false, leaving 'area' as it was, if they do not.
+		 */
+		bool MergeShape(NavArea* area, const NavArea* other, NavDirType dir, const std::vector<Vector>& areaCorners, const std::vector<Vector>& otherCorners) {
+			const bool Vertical = (dir == NORTH || dir == SOUTH);
+			// the one nearer the origin comes first
+			const NavArea* first = (dir == NORTH || dir == WEST) ? other : area;
+			const NavArea* second = (first == area) ? other : area;
+
+			const Extent& Lo = first->m_extent;
+			const Extent& Hi = second->m_extent;
+			auto apart = [](float a, float b) { return std::fabs(a - b) > Merge_Side_Tolerance; };
+			if (Vertical ? (apart(Lo.lo.x, Hi.lo.x) || apart(Lo.hi.x, Hi.hi.x) || apart(Lo.hi.y, Hi.lo.y))
+				: (apart(Lo.lo.y, Hi.lo.y) || apart(Lo.hi.y, Hi.hi.y) || apart(Lo.hi.x, Hi.lo.x)))
+				return false;
+
+			const Extent Merged_Extent{ Lo.lo, Hi.hi };
+			const float Ne_Z = Vertical ? first->m_neZ : second->m_neZ;
+			const float Sw_Z = Vertical ? second->m_swZ : first->m_swZ;
+			const Extent Old_Extent = area->m_extent;
+			const float Old_Ne_Z = area->m_neZ;
+			const float Old_Sw_Z = area->m_swZ;
+
+			area->m_extent = Merged_Extent;
+			area->m_neZ = Ne_Z;
+			area->m_swZ = Sw_Z;
+			for (auto* corners : { &areaCorners, &otherCorners }) {
+				for (auto& corner : *corners) {
+					if (std::fabs(area->GetZ(&corner) - corner.z) > Merge_Height_Tolerance) {
+						area->m_extent = Old_Extent;
+						area->m_neZ = Old_Ne_Z;
+						area->m_swZ = Old_Sw_Z;
+						return false;
+					}
+				}
+			}
+
+			area->m_center = (Merged_Extent.lo + Merged_Extent.hi) * 0.5f;
+			return true;
+		}
+
+		/// remove all but the first of the elements that compare equal
+		template<typename T, typename Equal>
+		void RemoveDuplicates(std::list<T>* elements, Equal equal) {
+			for (auto it = elements->begin(); it != elements->end();) {
+				if (std::any_of(elements->begin(), it, [&](const T& before) { return equal(before, *it); }))
+					it = elements->erase(it);
+				else
+					++it;
+			}
+		}
+	}
+
+	std::uint32_t NavigationMap::MergeAreas() {
+		// areas are renumbered below, which the records kept for lazy decoding cannot follow
+		DecodeAll();
+		ClearLazyDecoding();
+
+		const auto Area_Count = GetAreaCount();
+
+		// the area each one was merged into, itself if none; merged areas merge again, so follow it to the end
+		std::vector<std::uint32_t> mergedInto(Area_Count);
+		for (std::uint32_t i = 0; i < Area_Count; ++i)
+			mergedInto[i] = i;
+
+		auto find = [&mergedInto](std::uint32_t index) {
+			while (mergedInto[index] != index)
+				index = mergedInto[index];
+			return index;
+		};
+
+		// the one area on side 'dir' of 'area', or Invalid_Index if there are none or several
+		auto getOnlyNeighbour = [&find](const NavArea* area, NavDirType dir) {
+			std::uint32_t only = Invalid_Index;
+			for (auto& connect : area->m_connect[dir]) {
+				if (connect.index == Invalid_Index)
+					continue;
+
+				const std::uint32_t Neighbour = find(connect.index);
+				if (only != Invalid_Index && only != Neighbour)
+					return Invalid_Index;
+				only = Neighbour;
+			}
+			return only;
+		};
+
+		// the corners of the areas merged into each one so far, which must all stay on its surface
+		std::vector<std::vector<Vector>> corners(Area_Count);
+		for (std::uint32_t i = 0; i < Area_Count; ++i) {
+			const auto Corners = GetCorners(m_areaByIndex[i]);
+			AddCorners(&corners[i], { Corners.begin(), Corners.end() });
+		}
+
+		std::uint32_t merged = 0;
+		for (bool progress = true; progress;) {
+			progress = false;
+			for (std::uint32_t i = 0; i < Area_Count; ++i) {
+				if (mergedInto[i] != i)
+					continue;
+
+				NavArea* area = m_areaByIndex[i];
+				for (int d = 0; d < NUM_DIRECTIONS; ++d) {
+					const auto Dir = static_cast<NavDirType>(d);
+
+					// keep going while the next area that way fits, so a whole row merges at once
+					for (;;) {
+						const std::uint32_t Other_Index = getOnlyNeighbour(area, Dir);
+						if (Other_Index == Invalid_Index || Other_Index == i)
+							break;
+
+						NavArea* other = m_areaByIndex[Other_Index];
+						if (getOnlyNeighbour(other, OppositeDirection(Dir)) != i || other->m_attributeFlags != area->m_attributeFlags
+							|| other->m_place != area->m_place || area->hiding_spots.size() + other->hiding_spots.size() > Max_Area_Hiding_Spots
+							|| !MergeShape(area, other, Dir, corners[i], corners[Other_Index]))
+							break;
+
+						AddCorners(&corners[i], corners[Other_Index]);
+						std::vector<Vector>().swap(corners[Other_Index]);
+
+						// the far side of 'other' becomes this side of the merged area
+						area->m_connect[d].swap(other->m_connect[d]);
+						area->m_connect[(d + 1) % NUM_DIRECTIONS].splice(area->m_connect[(d + 1) % NUM_DIRECTIONS].end(), other->m_connect[(d + 1) % NUM_DIRECTIONS]);
+						area->m_connect[(d + 3) % NUM_DIRECTIONS].splice(area->m_connect[(d + 3) % NUM_DIRECTIONS].end(), other->m_connect[(d + 3) % NUM_DIRECTIONS]);
+						area->hiding_spots.splice(area->hiding_spots.end(), other->hiding_spots);
+						area->encounter_spots.splice(area->encounter_spots.end(), other->encounter_spots);
+						area->m_overlapList.splice(area->m_overlapList.end(), other->m_overlapList);
+						for (int a = 0; a < other->m_approachCount && area->m_approachCount < NavArea::MAX_APPROACH_AREAS; ++a)
+							area->m_approach[area->m_approachCount++] = other->m_approach[a];
+
+						mergedInto[Other_Index] = i;
+						++merged;
+						progress = true;
+					}
+				}
+			}
+		}
+
+		if (merged == 0)
+			return 0;
+
+		// point every reference at the area it ended up in, and drop those that are now inside one area
+		auto resolve = [&find](NavConnect& connect) {
+			if (connect.index != Invalid_Index)
+				connect.index = find(connect.index);
+		};
+		std::vector<std::uint32_t> kept;
+		kept.reserve(Area_Count - merged);
+		for (std::uint32_t i = 0; i < Area_Count; ++i) {
+			if (mergedInto[i] != i)
+				continue;
+
+			kept.push_back(i);
+			NavArea* area = m_areaByIndex[i];
+			for (auto& connections : area->m_connect) {
+				for (auto& connect : connections)
+					resolve(connect);
+
+				connections.remove_if([i](const NavConnect& connect) { return connect.index == i; });
+				RemoveDuplicates(&connections, std::equal_to<NavConnect>());
+			}
+
+			for (int a = 0; a < area->m_approachCount; ++a) {
+				resolve(area->m_approach[a].here);
+				resolve(area->m_approach[a].prev);
+				resolve(area->m_approach[a].next);
+			}
+
+			for (auto& e : area->encounter_spots) {
+				resolve(e.from);
+				resolve(e.to);
+			}
+			area->encounter_spots.remove_if([i](const SpotEncounter& e) { return e.from.index == i || e.to.index == i; });
+			RemoveDuplicates(&area->encounter_spots, [](const SpotEncounter& a, const SpotEncounter& b) { return a.from == b.from && a.to == b.to; });
+
+			for (auto& overlap : area->m_overlapList)
+				overlap = m_areaByIndex[find(overlap->m_index)];
+			area->m_overlapList.remove(area);
+			RemoveDuplicates(&area->m_overlapList, std::equal_to<NavArea*>());
+		}
+
+		// keep resolving the IDs of areas merged away, including by earlier merges
+		for (auto& [id, into] : m_mergedIDs) {
+			if (const NavArea* area = m_navAreaGrid.GetNavAreaByID(into); area != nullptr)
+				into = m_areaByIndex[find(area->m_index)]->m_id;
+		}
+
+		std::vector<NavArea*> removed;
+		removed.reserve(merged);
+		for (std::uint32_t i = 0; i < Area_Count; ++i) {
+			if (mergedInto[i] != i) {
+				m_mergedIDs[m_areaByIndex[i]->m_id] = m_areaByIndex[find(i)]->m_id;
+				removed.push_back(m_areaByIndex[i]);
+			}
+		}
+
+		RenumberAreas(kept);
+		for (auto& area : removed)
+			delete area;
+		BuildGrid();
+		m_placeIndex.Build(*this);
+
+		// the mesh no longer matches its file, so nothing kept for the file may be used with it
+		m_cache.reset();
+		m_fingerprint = 0;
+		return merged;
+	}
+
+	/**
+	 * Put every area in the grid, sized to hold them all.
+	 */
+	void NavigationMap::BuildGrid() {
+		Extent extent;
+		extent.lo.x = 9999999999.9f;
+		extent.lo.y = 9999999999.9f;
+		extent.hi.x = -9999999999.9f;
+		extent.hi.y = -9999999999.9f;
+
+		for (auto& area : m_areas) {
+			const Extent* areaExtent = &area->m_extent;
+
+			if (areaExtent->lo.x < extent.lo.x)
+				extent.lo.x = areaExtent->lo.x;
+			if (areaExtent->lo.y < extent.lo.y)
+				extent.lo.y = areaExtent->lo.y;
+			if (areaExtent->hi.x > extent.hi.x)
+				extent.hi.x = areaExtent->hi.x;
+			if (areaExtent->hi.y > extent.hi.y)
+				extent.hi.y = areaExtent->hi.y;
+		}
+
+		m_navAreaGrid.Initialize(extent.lo.x, extent.hi.x, extent.lo.y, extent.hi.y);
+		for (auto& area : m_areas) {
+			m_navAreaGrid.AddNavArea(area);
+		}
+	}
+
+	/**
+	 * Build everything that depends on the level being played: the ladders, and what is built on top of them.
+	 */
+	bool NavigationMap::AttachToLevel(EngineQueue* engine) {
+		if (m_cache == nullptr)
+			return false;
+
+		m_engine = engine;
+
+		// verify that the bsp hasn't changed
+		if (m_savedBspSize != 0) {
+			RunOnGameThread([saveBspSize = m_savedBspSize] {
+				std::string bspFilename = std::format("maps\\{}.bsp", STRING(gpGlobals->mapname));
+				std::uint32_t bspSize = (std::uint32_t)GET_FILE_SIZE(bspFilename);
+
+				if (bspSize != saveBspSize) {
+					// this nav file is out of date for this bsp file
+					const char* msg = "*** WARNING ***\nThe AI navigation data is from a different version of this map.\nThe CPU players will likely not perform well.\n";
+					SERVER_PRINT("\n-----------------\n");
+					SERVER_PRINT(msg);
+					SERVER_PRINT("-----------------\n\n");
+				}
+			});
+		}
+
+		// what was traced on another level may not hold on this one
+		m_groundHeightCache.Clear();
+		++m_generation;
+
+		//
+		// Set up all the ladders
+		//
+		if (!m_ladderBuilding) {
+			DestroyLadders();
+		} else if (!BuildLadders(m_cache.get())) {
+			// the game thread gave up on this load
+			m_engine = nullptr;
+			Destroy();
+			return false;
+		}
+
+		// the tables below only depend on the mesh and the ladders, so another server may have built them already
+		const std::uint64_t Level_Key = GetLevelKey();
+		if (!AttachImage(Level_Key)) {
+			// everything below reads the hiding spots and encounters of every area
+			DecodeAll();
+
+			// resolve connections and ladders into the dense area graph used by path searches
+			BuildAreaGraph();
+
+			// encounter paths run between portals, so they need the portal table
+			BuildEncounterPaths();
+			BuildEncounterIndex();
+
+			// which areas can possibly see each other, so line of sight checks can skip hopeless traces
+			m_visibility.Build(*this);
+
+			// share them with the next server to load this map, and with this one
+			if (m_imageSharing && SaveImage(Level_Key))
+				AttachImage(Level_Key);
+		} else {
+			// the image holds the tables, but the encounters of the areas still need their paths
+			BuildEncounterPaths();
+		}
+
+		// with lazy decoding, the index decodes the spots when it is first asked for
+		m_hidingSpotIndexReady = false;
+		if (m_decodedParts == nullptr) {
+			m_hidingSpotIndex.Build(*this);
+			m_hidingSpotIndexReady = true;
+		}
+
+		m_engine = nullptr;
+		return true;
+	}
+
+	/**
+	 * Identify the ladders of the level and the order of the areas, since the tables of an image depend on them as
+	 * well as on the mesh.
+	 */
+	std::uint64_t NavigationMap::GetLevelKey() const {
+		// a map loaded without its ladders must not take the image of one with them
+		const std::vector<std::uint8_t>* ladders = m_ladderBuilding && m_cache != nullptr ? m_cache->GetSection(NavCache::LADDER_SECTION) : nullptr;
+		const std::uint64_t Ladder_Key = ladders != nullptr ? FingerprintData(*ladders) : 0;
+		return Ladder_Key ^ m_areaOrder * 0x9E3779B97F4A7C15ull;
+	}
+
+	/**
+	 * View the tables derived from the mesh in the shared image of this map, instead of building them.
+	 * Return false, with nothing viewed, if there is no image made for this mesh and these ladders.
+	 */
+	bool NavigationMap::AttachImage(std::uint64_t levelKey) {
+		// the image of the previous level may no longer fit
+		DropImage();
+		if (!m_imageSharing)
+			return false;
+
+		m_image = NavImage::Open(NavImage::GetPathFor(m_path), m_fingerprint, levelKey);
+		if (m_image == nullptr)
+			return false;
+
+		const NavImage& Image = *m_image;
+		const auto Area_Count = GetAreaCount();
+		bool viewed = m_links.View(Image, NavImage::LINK_SECTION) && m_linkStart.View(Image, NavImage::LINK_START_SECTION)
+			&& m_incomingStart.View(Image, NavImage::INCOMING_START_SECTION) && m_incomingLinks.View(Image, NavImage::INCOMING_LINK_SECTION)
+			&& m_portals.View(Image, NavImage::PORTAL_SECTION) && m_encounters.View(Image, NavImage::ENCOUNTER_SECTION)
+			&& m_encounterStart.View(Image, NavImage::ENCOUNTER_START_SECTION) && m_encounterTable.View(Image, NavImage::ENCOUNTER_TABLE_SECTION)
+			&& m_encounterSpots.View(Image, NavImage::ENCOUNTER_SPOT_SECTION);
+
+		// every table must fit this map, or an index read from one could point anywhere
+		viewed = viewed && m_linkStart.size() == Area_Count + 1 && m_linkStart.back() == m_links.size() && m_portals.size() == m_links.size()
+			&& m_incomingStart.size() == Area_Count + 1 && m_incomingStart.back() == m_incomingLinks.size() && m_incomingLinks.size() == m_links.size()
+			&& m_encounterStart.size() == Area_Count + 1 && m_encounterStart.back() == m_encounters.size()
+			&& !m_encounterTable.empty() && (m_encounterTable.size() & (m_encounterTable.size() - 1)) == 0;
+
+		viewed = viewed && AreImageIndicesValid() && m_visibility.View(Image, Area_Count);
+
+		// tables built by this process, about to be shared, are kept until the image is certain to be used
+		if (!viewed) {
+			DropImage();
+			return false;
+		}
+
+		m_links.ReleaseOwned();
+		m_linkStart.ReleaseOwned();
+		m_incomingStart.ReleaseOwned();
+		m_incomingLinks.ReleaseOwned();
+		m_portals.ReleaseOwned();
+		m_encounters.ReleaseOwned();
+		m_encounterStart.ReleaseOwned();
+		m_encounterTable.ReleaseOwned();
+		m_encounterSpots.ReleaseOwned();
+		return true;
+	}
+
+	/**
+	 * Check every index read from the tables of an image against the sizes of this map, since they are followed
+	 * without any further checks. The tables must already have the sizes AttachImage() expects.
+	 */
+	bool NavigationMap::AreImageIndicesValid() const {
+		const auto Area_Count = GetAreaCount();
+		const auto Link_Count = m_links.size();
+
+		// a start going backwards would make the span of an area wrap around
+		auto isOrdered = [](const ImageArray<std::uint32_t>& start) {
+			return std::is_sorted(start.begin(), start.end()) && start[0] == 0;
+		};
+		if (!isOrdered(m_linkStart) || !isOrdered(m_incomingStart) || !isOrdered(m_encounterStart))
+			return false;
+
+		for (auto& link : m_links) {
+			if (link.from >= Area_Count || link.to >= Area_Count)
+				return false;
+		}
+
+		for (auto linkIndex : m_incomingLinks) {
+			if (linkIndex >= Link_Count)
+				return false;
+		}
+
+		std::uint64_t spotCount = 0;
+		for (auto& encounter : m_encounters) {
+			if (encounter.from >= Area_Count || encounter.to >= Area_Count
+				|| static_cast<std::uint64_t>(encounter.firstSpot) + encounter.spotCount > m_encounterSpots.size())
+				return false;
+			spotCount += encounter.spotCount;
+		}
+		if (spotCount != m_encounterSpots.size())
+			return false;
+
+		for (auto& order : m_encounterSpots) {
+			if (order.spot >= GetHidingSpotCount())
+				return false;
+		}
+
+		// lookups probe until they meet an empty slot, so there must be one
+		bool emptySlot = false;
+		for (auto index : m_encounterTable) {
+			if (index == Invalid_Index)
+				emptySlot = true;
+			else if (index >= m_encounters.size())
+				return false;
+		}
+		return emptySlot;
+	}
+
+	/**
+	 * Stop viewing the image, going back to the tables built by this process, if any.
+	 */
+	void NavigationMap::DropImage() {
+		m_links.DropView();
+		m_linkStart.DropView();
+		m_incomingStart.DropView();
+		m_incomingLinks.DropView();
+		m_portals.DropView();
+		m_encounters.DropView();
+		m_encounterStart.DropView();
+		m_encounterTable.DropView();
+		m_encounterSpots.DropView();
+		m_visibility.DropView();
+		m_image.reset();
+	}
+
+	bool NavigationMap::SaveImage(std::uint64_t levelKey) const {
+		std::vector<NavImage::Section> sections = {
+			m_links.GetImageSection(NavImage::LINK_SECTION),
+			m_linkStart.GetImageSection(NavImage::LINK_START_SECTION),
+			m_incomingStart.GetImageSection(NavImage::INCOMING_START_SECTION),
+			m_incomingLinks.GetImageSection(NavImage::INCOMING_LINK_SECTION),
+			m_portals.GetImageSection(NavImage::PORTAL_SECTION),
+			m_encounters.GetImageSection(NavImage::ENCOUNTER_SECTION),
+			m_encounterStart.GetImageSection(NavImage::ENCOUNTER_START_SECTION),
+			m_encounterTable.GetImageSection(NavImage::ENCOUNTER_TABLE_SECTION),
+			m_encounterSpots.GetImageSection(NavImage::ENCOUNTER_SPOT_SECTION),
+		};
+		m_visibility.AddImageSections(&sections);
+		return NavImage::Write(NavImage::GetPathFor(m_path), m_fingerprint, levelKey, sections);
+	}
+
+	bool NavigationMap::IsFileUnchanged() const {
+		std::error_code error;
+		const auto Size = std::filesystem::file_size(m_path, error);
+		if (error || Size != m_fileSize)
+			return false;
+
+		const auto Time = std::filesystem::last_write_time(m_path, error);
+		return !error && Time == m_fileTime;
+	}
+
+	std::size_t NavigationMap::GetMemoryUsage() const {
+		// list nodes cost two pointers on top of their value
+		constexpr std::size_t Node = 2 * sizeof(void*);
+
+		// the lists may be growing on another thread, see Decode()
+		std::lock_guard lock(m_decodeMutex);
+
+		std::size_t bytes = sizeof(NavigationMap);
+		for (auto area : m_areas) {
+			bytes += sizeof(NavArea) + Node;
+			for (auto& connections : area->m_connect)
+				bytes += connections.size() * (sizeof(NavConnect) + Node);
+
+			bytes += area->m_overlapList.size() * (sizeof(NavArea*) + Node);
+			bytes += area->hiding_spots.size() * (sizeof(HidingSpot*) + Node);
+			for (auto& e : area->encounter_spots)
+				bytes += sizeof(SpotEncounter) + Node + e.spotList.size() * (sizeof(SpotOrder) + Node);
+		}
+		bytes += m_hidingSpots.size() * (sizeof(HidingSpot) + Node);
+		bytes += m_navLadders.size() * (sizeof(NavLadder) + Node);
+		bytes += m_mergedIDs.size() * (2 * sizeof(std::uint32_t) + Node);
+
+		auto vectorBytes = [](const auto& v) { return v.capacity() * sizeof(v[0]); };
+		bytes += vectorBytes(m_areaByIndex) + vectorBytes(m_spotByIndex) + vectorBytes(m_links) + vectorBytes(m_linkStart) + vectorBytes(m_incomingStart)
+			+ vectorBytes(m_incomingLinks) + vectorBytes(m_portals) + vectorBytes(m_encounters) + vectorBytes(m_encounterStart)
+			+ vectorBytes(m_encounterSpots) + vectorBytes(m_encounterTable)
+			+ vectorBytes(m_lazyBytes) + vectorBytes(m_lazyRecords) + vectorBytes(m_spotStart) + vectorBytes(m_spotIndexByID);
+		if (m_decodedParts != nullptr)
+			bytes += GetAreaCount() * sizeof(m_decodedParts[0]);
+		bytes += m_visibility.GetStats().memoryBytes;
+		bytes += m_placeIndex.GetMemoryUsage();
+		return bytes;
+	}
+
+	void NavigationMap::Destroy() {
+		// remove each element of the list and delete them
+		while (!m_areas.empty()) {
+			auto area = m_areas.front();
+			m_areas.pop_front();
+			delete area;
+		}
+
+		// destroy ladder representations
+		DestroyLadders();
+
+		// destroy all hiding spots
+		DestroyHidingSpots();
+		// reset the grid
+		m_navAreaGrid.Reset();
+
+		// forget the area graph; anything holding indices into it must start over
+		m_areaByIndex.clear();
+		m_links.clear();
+		m_linkStart.clear();
+		m_incomingStart.clear();
+		m_incomingLinks.clear();
+		m_portals.clear();
+		m_encounters.clear();
+		m_encounterStart.clear();
+		m_encounterSpots.clear();
+		m_encounterTable.clear();
+		m_visibility.Clear();
+		m_hidingSpotIndex.Clear();
+		m_hidingSpotIndexReady = false;
+		m_placeIndex.Clear();
+		ClearLazyDecoding();
+		m_groundHeightCache.Clear();
+		m_image.reset();
+		m_path.clear();
+		m_cache.reset();
+		m_mergedIDs.clear();
+		m_savedBspSize = 0;
+		++m_generation;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * Assign dense indices to the areas, in file order, so that references between them can be resolved.
+	 */
+	void NavigationMap::IndexAreas() {
+		m_areaByIndex.clear();
+		m_areaByIndex.reserve(m_areas.size());
+		for (auto& area : m_areas) {
+			area->m_index = static_cast<std::uint32_t>(m_areaByIndex.size());
+			m_areaByIndex.push_back(area);
+		}
+	}
+
+	/**
+	 * Renumber the areas in the order set by SetAreaOrder(), and the hiding spots in the order of their areas,
+	 * rewriting every resolved reference to match. Must be called after Validate().
+	 */
+	void NavigationMap::OrderAreas() {
+		const auto Area_Count = GetAreaCount();
+		if (m_areaOrder == FILE_AREA_ORDER || Area_Count == 0)
+			return;
+
+		// Hilbert order first, since it also seeds the breadth first order
+		Extent bounds{ m_areaByIndex[0]->m_center, m_areaByIndex[0]->m_center };
+		for (auto& area : m_areaByIndex) {
+			bounds.lo.x = (std::min)(bounds.lo.x, area->m_center.x);
+			bounds.lo.y = (std::min)(bounds.lo.y, area->m_center.y);
+			bounds.hi.x = (std::max)(bounds.hi.x, area->m_center.x);
+			bounds.hi.y = (std::max)(bounds.hi.y, area->m_center.y);
+		}
+
+		auto quantize = [](float value, float lo, float hi) {
+			return hi > lo ? static_cast<std::uint32_t>((value - lo) / (hi - lo) * 65535.0f) : 0u;
+		};
+		std::vector<std::uint32_t> keys(Area_Count);
+		for (std::uint32_t i = 0; i < Area_Count; ++i) {
+			const Vector& Center = m_areaByIndex[i]->m_center;
+			keys[i] = GetHilbertKey(quantize(Center.x, bounds.lo.x, bounds.hi.x), quantize(Center.y, bounds.lo.y, bounds.hi.y));
+		}
+
+		// old index of each area, in the new order
+		std::vector<std::uint32_t> oldIndex(Area_Count);
+		for (std::uint32_t i = 0; i < Area_Count; ++i)
+			oldIndex[i] = i;
+		std::stable_sort(oldIndex.begin(), oldIndex.end(), [&keys](std::uint32_t a, std::uint32_t b) { return keys[a] < keys[b]; });
+
+		if (m_areaOrder == BFS_AREA_ORDER) {
+			std::vector<std::uint32_t> visits;
+			std::vector<std::uint8_t> visited(Area_Count, 0);
+			visits.reserve(Area_Count);
+			for (auto seed : oldIndex) {
+				if (visited[seed])
+					continue;
+
+				visited[seed] = 1;
+				visits.push_back(seed);
+				for (std::size_t next = visits.size() - 1; next < visits.size(); ++next) {
+					for (auto& connections : m_areaByIndex[visits[next]]->m_connect) {
+						for (auto& connect : connections) {
+							if (connect.index != Invalid_Index && !visited[connect.index]) {
+								visited[connect.index] = 1;
+								visits.push_back(connect.index);
+							}
+						}
+					}
+				}
+			}
+			oldIndex.swap(visits);
+		}
+		RenumberAreas(oldIndex);
+	}
+
+	/**
+	 * Keep the areas at the given indices, in that order, with the hiding spots in the order of their areas, and
+	 * rewrite every resolved reference to match. References to areas left out become Invalid_Index.
+	 */
+	void NavigationMap::RenumberAreas(const std::vector<std::uint32_t>& oldIndex) {
+		std::vector<NavArea*> areas(oldIndex.size());
+		std::vector<std::uint32_t> newIndex(GetAreaCount(), Invalid_Index);
+		for (std::uint32_t i = 0; i < oldIndex.size(); ++i) {
+			areas[i] = m_areaByIndex[oldIndex[i]];
+			newIndex[oldIndex[i]] = i;
+		}
+
+		// spots follow their areas; any that belong to none keep their order at the end
+		std::vector<HidingSpot*> spots;
+		std::vector<std::uint32_t> newSpot(m_spotByIndex.size(), Invalid_Index);
+		spots.reserve(m_spotByIndex.size());
+		auto addSpot = [&](HidingSpot* spot) {
+			if (newSpot[spot->m_index] == Invalid_Index) {
+				newSpot[spot->m_index] = static_cast<std::uint32_t>(spots.size());
+				spots.push_back(spot);
+			}
+		};
+		for (auto& area : areas) {
+			for (auto& spot : area->hiding_spots)
+				addSpot(spot);
+		}
+		for (auto& spot : m_spotByIndex)
+			addSpot(spot);
+
+		auto renumber = [&newIndex](NavConnect& connect) {
+			if (connect.index != Invalid_Index)
+				connect.index = newIndex[connect.index];
+		};
+		for (auto& area : areas) {
+			area->m_index = newIndex[area->m_index];
+			for (auto& connections : area->m_connect) {
+				for (auto& connect : connections)
+					renumber(connect);
+			}
+
+			for (int a = 0; a < area->m_approachCount; ++a) {
+				renumber(area->m_approach[a].here);
+				renumber(area->m_approach[a].prev);
+				renumber(area->m_approach[a].next);
+			}
+
+			for (auto& e : area->encounter_spots) {
+				renumber(e.from);
+				renumber(e.to);
+				for (auto& order : e.spotList) {
+					if (order.spot != Invalid_Index)
+						order.spot = newSpot[order.spot];
+				}
+			}
+		}
+		for (std::uint32_t i = 0; i < spots.size(); ++i)
+			spots[i]->m_index = i;
+
+		m_areaByIndex = std::move(areas);
+		m_spotByIndex = std::move(spots);
+		m_areas.assign(m_areaByIndex.begin(), m_areaByIndex.end());
+		m_hidingSpots.assign(m_spotByIndex.begin(), m_spotByIndex.end());
+	}
+
+	/// return the dense index of the area with the given ID, or Invalid_Index if there is none
+	std::uint32_t NavigationMap::ResolveAreaID(std::uint32_t id) const {
+		const NavArea* area = m_navAreaGrid.GetNavAreaByID(id);
+		return area != nullptr ? area->m_index : Invalid_Index;
+	}
+
+	/**
+	 * Flatten the connections and ladders of the areas into links.
+	 * Must be called after Validate() and BuildLadders(), since it follows resolved references.
+	 */
+	void NavigationMap::BuildAreaGraph() {
+		const auto Area_Count = GetAreaCount();
+		auto& links = m_links.Edit();
+		auto& portals = m_portals.Edit();
+		auto& linkStart = m_linkStart.Edit();
+		links.clear();
+		portals.clear();
+		linkStart.assign(Area_Count + 1, 0);
+
+		auto addLink = [&links, &portals](const NavArea* from, const NavArea* to, NavTraverseType how, const NavPortal& portal) {
+			if (to == nullptr || to == from)
+				return;
+
+			links.push_back({ from->m_index, to->m_index, how, (to->m_center - from->m_center).Length() });
+			portals.push_back(portal);
+		};
+
+		// ladders are vertical, so both ends share the same 2D position
+		auto ladderPortal = [](const Vector& mount, const Vector& dismount) {
+			return NavPortal{ ImagePoint::From(mount), 0.0f, mount.z, mount.z, dismount.z };
+		};
+
+		for (auto& area : m_areaByIndex) {
+			linkStart[area->m_index] = static_cast<std::uint32_t>(links.size());
+
+			for (int d = 0; d < NUM_DIRECTIONS; d++) {
+				for (auto& connect : area->m_connect[d]) {
+					const NavArea* to = GetArea(connect);
+					if (to == nullptr)
+						continue;
+
+					NavPortal portal{};
+					Vector center;
+					area->ComputePortal(to, static_cast<NavDirType>(d), &center, &portal.halfWidth);
+					center.z = area->GetZ(&center);
+					portal.center = ImagePoint::From(center);
+					portal.toZ = to->GetZ(&center);
+					addLink(area, to, static_cast<NavTraverseType>(d), portal);
+
+					Vector left, right;
+					GetPortalEndpoints(static_cast<std::uint32_t>(links.size() - 1), 0.0f, &left, &right);
+					portals.back().leftZ = area->GetZ(&left);
+					portals.back().rightZ = area->GetZ(&right);
+				}
+			}
+
+			// the "behind" area is only useful for descending, so it is not a way up the ladder
+			for (auto& ladder : area->m_ladder[LADDER_UP]) {
+				const NavPortal portal = ladderPortal(ladder->m_bottom, ladder->m_top);
+				addLink(area, ladder->m_topForwardArea, GO_LADDER_UP, portal);
+				addLink(area, ladder->m_topLeftArea, GO_LADDER_UP, portal);
+				addLink(area, ladder->m_topRightArea, GO_LADDER_UP, portal);
+			}
+
+			for (auto& ladder : area->m_ladder[LADDER_DOWN])
+				addLink(area, ladder->m_bottomArea, GO_LADDER_DOWN, ladderPortal(ladder->m_top, ladder->m_bottom));
+		}
+		linkStart[Area_Count] = static_cast<std::uint32_t>(links.size());
+
+		// bucket the links by the area they enter
+		auto& incomingStart = m_incomingStart.Edit();
+		auto& incomingLinks = m_incomingLinks.Edit();
+		incomingStart.assign(Area_Count + 1, 0);
+		for (auto& link : links)
+			++incomingStart[link.to + 1];
+
+		for (std::uint32_t i = 0; i < Area_Count; ++i)
+			incomingStart[i + 1] += incomingStart[i];
+
+		incomingLinks.resize(links.size());
+		std::vector<std::uint32_t> fill(incomingStart.begin(), incomingStart.end() - 1);
+		for (std::uint32_t i = 0; i < links.size(); ++i)
+			incomingLinks[fill[links[i].to]++] = i;
+	}
+
+	std::span<const NavLink> NavigationMap::GetOutgoingLinks(std::uint32_t area) const {
+		return { m_links.data() + m_linkStart[area], m_links.data() + m_linkStart[area + 1] };
+	}
+
+	std::span<const std::uint32_t> NavigationMap::GetIncomingLinks(std::uint32_t area) const {
+		return { m_incomingLinks.data() + m_incomingStart[area], m_incomingLinks.data() + m_incomingStart[area + 1] };
+	}
+
+	std::uint32_t NavigationMap::FindLink(std::uint32_t from, std::uint32_t to) const {
+		std::uint32_t found = Invalid_Index;
+		for (std::uint32_t i = m_linkStart[from]; i < m_linkStart[from + 1]; ++i) {
+			if (m_links[i].to != to)
+				continue;
+
+			if (m_links[i].how < GO_LADDER_UP)
+				return i;
+
+			found = i;
+		}
+		return found;
+	}
+
+	void NavigationMap::GetPortalEndpoints(std::uint32_t link, float margin, Vector* left, Vector* right) const {
+		const NavPortal& portal = m_portals[link];
+		const float halfWidth = portal.halfWidth - (std::fmin)(margin, portal.halfWidth);
+
+		// the opening runs along the edge we cross; 'side' points to the left of the way we are moving
+		Vector2D side;
+		switch (m_links[link].how) {
+			case GO_NORTH:	side = Vector2D(1.0f, 0.0f); break;
+			case GO_SOUTH:	side = Vector2D(-1.0f, 0.0f); break;
+			case GO_EAST:	side = Vector2D(0.0f, 1.0f); break;
+			case GO_WEST:	side = Vector2D(0.0f, -1.0f); break;
+			default:		side = Vector2D(0.0f, 0.0f); break;
+		}
+
+		// Z is linear along the edge of an area
+		const float t = (portal.halfWidth > 0.0f) ? halfWidth / portal.halfWidth : 0.0f;
+		const float centerZ = (portal.leftZ + portal.rightZ) / 2.0f;
+
+		left->x = portal.center.x + side.x * halfWidth;
+		left->y = portal.center.y + side.y * halfWidth;
+		left->z = centerZ + t * (portal.leftZ - centerZ);
+
+		right->x = portal.center.x - side.x * halfWidth;
+		right->y = portal.center.y - side.y * halfWidth;
+		right->z = centerZ + t * (portal.rightZ - centerZ);
+	}
+
+	float NavigationMap::GetLinkCost(const NavLink& link, const AreaBlocking* blocking) const noexcept {
+		if (blocking != nullptr && !blocking->IsAreaEnabled(link.to))
+			return std::numeric_limits<float>::infinity();
+
+		return link.length;
+	}
+
+	float NavigationMap::GetHeuristicCost(std::uint32_t from, std::uint32_t to) const noexcept {
+		// links are as long as the distance between centers, so this never overestimates
+		return (m_areaByIndex[to]->m_center - m_areaByIndex[from]->m_center).Length();
+	}
+
+	bool NavigationMap::IsWalkableLine(const Vector& from, const Vector& to, Vector* hitPos, const NavArea** lastArea, const AreaBlocking* blocking) const {
+		const NavArea* area = GetNavArea(&from);
+		auto blocked = [&](const NavArea* at, const Vector& pos) {
+			if (hitPos)
+				*hitPos = pos;
+			if (lastArea)
+				*lastArea = at;
+			return false;
+		};
+
+		if (area == nullptr)
+			return blocked(nullptr, from);
+
+		// tolerance for landing exactly on a corner or the end of an opening
+		constexpr float Edge_Tolerance = 0.01f;
+		const float Dx = to.x - from.x;
+		const float Dy = to.y - from.y;
+		const float Length = std::sqrt(Dx * Dx + Dy * Dy);
+		constexpr float Never = std::numeric_limits<float>::infinity();
+
+		// every step enters another area, so this bounds the walk even on broken meshes
+		for (std::uint32_t step = 0; step <= GetAreaCount(); ++step) {
+			if (area->IsOverlapping(&to)) {
+				// under or over 'to' is not enough - the line must end on the floor 'to' is on
+				if (std::fabs(area->GetZ(&to) - to.z) > StepHeight && area != GetNavArea(&to))
+					return blocked(area, Vector(to.x, to.y, area->GetZ(&to)));
+
+				if (lastArea)
+					*lastArea = area;
+				return true;
+			}
+
+			// where the line leaves the area, as a fraction of the line
+			float exitX = Never, exitY = Never;
+			if (Dx > 0.0f)
+				exitX = (area->m_extent.hi.x - from.x) / Dx;
+			else if (Dx < 0.0f)
+				exitX = (area->m_extent.lo.x - from.x) / Dx;
+
+			if (Dy > 0.0f)
+				exitY = (area->m_extent.hi.y - from.y) / Dy;
+			else if (Dy < 0.0f)
+				exitY = (area->m_extent.lo.y - from.y) / Dy;
+
+			const float Exit = (std::min)(exitX, exitY);
+			Vector pos(from.x + Exit * Dx, from.y + Exit * Dy, 0.0f);
+			pos.z = area->GetZ(pos.x, pos.y);
+
+			// at a corner both sides are candidates
+			NavDirType sides[2];
+			int sideCount = 0;
+			if ((exitX - Exit) * Length <= Edge_Tolerance)
+				sides[sideCount++] = (Dx > 0.0f) ? EAST : WEST;
+			if ((exitY - Exit) * Length <= Edge_Tolerance)
+				sides[sideCount++] = (Dy > 0.0f) ? SOUTH : NORTH;
+
+			const NavArea* next = nullptr;
+			for (int i = 0; i < sideCount && next == nullptr; ++i) {
+				for (auto& link : GetOutgoingLinks(area->m_index)) {
+					if (link.how != static_cast<NavTraverseType>(sides[i]) || (blocking != nullptr && !blocking->IsAreaEnabled(link.to)))
+						continue;
+
+					// is the crossing point within the opening?
+					const NavPortal& portal = m_portals[GetLinkIndex(link)];
+					const float Along = (sides[i] == NORTH || sides[i] == SOUTH) ? pos.x - portal.center.x : pos.y - portal.center.y;
+					if (std::fabs(Along) > portal.halfWidth + Edge_Tolerance)
+						continue;
+
+					const NavArea* candidate = m_areaByIndex[link.to];
+					if (std::fabs(candidate->GetZ(pos.x, pos.y) - pos.z) > StepHeight)
+						continue;
+
+					next = candidate;
+					break;
+				}
+			}
+
+			if (next == nullptr)
+				return blocked(area, pos);
+
+			area = next;
+		}
+		return blocked(area, from);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * Compute the path segment of each spot encounter, between the portals it enters and leaves the area by.
+	 * Encounters decoded lazily later on get theirs when decoded, see DecodeLocked().
+	 */
+	void NavigationMap::BuildEncounterPaths() {
+		for (auto& area : m_areaByIndex) {
+			for (auto& e : area->encounter_spots)
+				ComputeEncounterPath(area, &e);
+		}
+	}
+
+	/**
+	 * Compute the path segment of one encounter of 'area'. Only reads the link and portal tables, so it works the
+	 * same whether they were built or come from an image.
+	 */
+	void NavigationMap::ComputeEncounterPath(const NavArea* area, SpotEncounter* encounter) const {
+		const float eyeHeight = HalfHumanHeight;
+
+		// return the portal center from 'area' into 'other', with z on 'other'
+		auto portalCenter = [this](const NavArea* area, const NavArea* other, NavDirType dir) {
+			if (std::uint32_t link = FindLink(area->m_index, other->m_index); link != Invalid_Index && m_links[link].how == static_cast<NavTraverseType>(dir)) {
+				const NavPortal& portal = m_portals[link];
+				return Vector(portal.center.x, portal.center.y, portal.toZ);
+			}
+
+			// there is no link this way (ie: we can only drop into 'area' from 'other'), so compute it
+			Vector center;
+			float halfWidth;
+			area->ComputePortal(other, dir, &center, &halfWidth);
+			center.z = other->GetZ(&center);
+			return center;
+		};
+
+		// corrupt entries were reported by Validate(), and have no path
+		if (encounter->from.index == Invalid_Index || encounter->to.index == Invalid_Index) {
+			encounter->path.from = Vector(0, 0, 0);
+			encounter->path.to = Vector(0, 0, 0);
+			return;
+		}
+
+		encounter->path.from = portalCenter(area, GetArea(encounter->from), encounter->fromDir);
+		encounter->path.to = portalCenter(area, GetArea(encounter->to), encounter->toDir);
+		encounter->path.from.z += eyeHeight;
+		encounter->path.to.z += eyeHeight;
+	}
+
+	namespace {
+		std::uint32_t HashEncounterKey(std::uint32_t area, std::uint32_t from, std::uint32_t to) noexcept {
+			std::uint64_t hash = area * 0x9E3779B97F4A7C15ull ^ from * 0xC2B2AE3D27D4EB4Full ^ to * 0x165667B19E3779F9ull;
+			hash ^= hash >> 29;
+			hash *= 0xBF58476D1CE4E5B9ull;
+			return static_cast<std::uint32_t>(hash >> 32);
+		}
+	}
+
+	/**
+	 * Flatten the encounter lists of every area into the packed encounter and spot arrays, and hash them by
+	 * (area, from, to). Must be called after BuildEncounterPaths(), since it copies the path segments.
+	 */
+	void NavigationMap::BuildEncounterIndex() {
+		const auto Area_Count = GetAreaCount();
+		auto& encounters = m_encounters.Edit();
+		auto& encounterStart = m_encounterStart.Edit();
+		auto& encounterSpots = m_encounterSpots.Edit();
+		encounters.clear();
+		encounterSpots.clear();
+		encounterStart.assign(Area_Count + 1, 0);
+
+		for (std::uint32_t i = 0; i < Area_Count; ++i) {
+			const auto First = encounters.size();
+			for (auto& e : m_areaByIndex[i]->encounter_spots) {
+				// corrupt entries were reported by Validate()
+				if (e.from.index == Invalid_Index || e.to.index == Invalid_Index)
+					continue;
+
+				NavEncounter encounter{ e.from.index, e.to.index, e.fromDir, e.toDir, ImageRay::From(e.path), static_cast<std::uint32_t>(encounterSpots.size()), 0 };
+				for (auto& order : e.spotList) {
+					if (order.spot == Invalid_Index)
+						continue;
+
+					encounterSpots.push_back(order);
+					++encounter.spotCount;
+				}
+				encounters.push_back(encounter);
+			}
+
+			// stable, so duplicates keep their file order and the first one wins below
+			std::stable_sort(encounters.begin() + First, encounters.end(), [](const NavEncounter& a, const NavEncounter& b) {
+				return a.from < b.from || (a.from == b.from && a.to < b.to);
+			});
+			encounterStart[i + 1] = static_cast<std::uint32_t>(encounters.size());
+		}
+
+		// keep the table at most half full so probe sequences stay short
+		std::size_t tableSize = 16;
+		while (tableSize < 2 * encounters.size())
+			tableSize *= 2;
+
+		auto& encounterTable = m_encounterTable.Edit();
+		encounterTable.assign(tableSize, Invalid_Index);
+		const std::size_t Mask = tableSize - 1;
+		for (std::uint32_t area = 0; area < Area_Count; ++area) {
+			for (std::uint32_t i = encounterStart[area]; i < encounterStart[area + 1]; ++i) {
+				if (FindEncounter(area, encounters[i].from, encounters[i].to) != nullptr)
+					continue;
+
+				std::size_t slot = HashEncounterKey(area, encounters[i].from, encounters[i].to) & Mask;
+				while (encounterTable[slot] != Invalid_Index)
+					slot = (slot + 1) & Mask;
+
+				encounterTable[slot] = i;
+			}
+		}
+	}
+
+	std::span<const NavEncounter> NavigationMap::GetEncounters(std::uint32_t area) const {
+		return { m_encounters.data() + m_encounterStart[area], m_encounterStart[area + 1] - m_encounterStart[area] };
+	}
+
+	const NavEncounter* NavigationMap::FindEncounter(std::uint32_t area, std::uint32_t from, std::uint32_t to) const {
+		if (m_encounterTable.empty() || area >= GetAreaCount())
+			return nullptr;
+
+		const std::size_t Mask = m_encounterTable.size() - 1;
+		for (std::size_t slot = HashEncounterKey(area, from, to) & Mask; m_encounterTable[slot] != Invalid_Index; slot = (slot + 1) & Mask) {
+			// the encounter belongs to 'area' if it lies within its range
+			const std::uint32_t Index = m_encounterTable[slot];
+			const NavEncounter& encounter = m_encounters[Index];
+			if (encounter.from == from && encounter.to == to && Index >= m_encounterStart[area] && Index < m_encounterStart[area + 1])
+				return &encounter;
+		}
+		return nullptr;
+	}
+
+	void NavigationMap::WarmGroundHeightCache() {
+		for (auto area : m_areas) {
+			const Vector Corners[NUM_CORNERS] = {
+				area->m_extent.lo,
+				Vector(area->m_extent.hi.x, area->m_extent.lo.y, area->m_neZ),
+				area->m_extent.hi,
+				Vector(area->m_extent.lo.x, area->m_extent.hi.y, area->m_swZ),
+			};
+
+			// just above the floor, where bots standing on the area will ask
+			for (auto& corner : Corners) {
+				const Vector Pos = corner + Vector(0, 0, HalfHumanHeight);
+				float height;
+				GetGroundHeight(&Pos, &height, nullptr, &m_groundHeightCache);
+			}
+		}
+	}
+
+	bool NavigationMap::IsLineOfSightClear(const Vector& from, const Vector& to, edict_t* ignore) const {
+		if (m_visibilityCulling) {
+			const NavArea* fromArea = GetNavArea(&from);
+			const NavArea* toArea = GetNavArea(&to);
+			if (fromArea != nullptr && toArea != nullptr && !m_visibility.Check(fromArea->m_index, toArea->m_index))
+				return false;
+		}
+
+		TraceResult result;
+		UTIL_TraceLine(from, to, ignore_monsters, ignore_glass, ignore, &result);
+		return result.flFraction >= 1.0f;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * Run a job that needs the engine. While loading on another thread it runs on the game thread, and this waits
+	 * for it; return false if the game thread stopped taking engine work.
+	 */
+	bool NavigationMap::RunOnGameThread(const std::function<void()>& job) {
+		if (m_engine == nullptr) {
+			job();
+			return true;
+		}
+		return m_engine->Call(job);
+	}
+
+	/**
+	 * Print to the server console, which is only safe from the game thread.
+	 */
+	void NavigationMap::Print(const char* message) {
+		if (m_engine == nullptr)
+			SERVER_PRINT(message);
+		else
+			m_engine->Post([text = std::string(message)] { SERVER_PRINT(text.c_str()); });
+	}
+
+	/**
+	 * Resolve the IDs an area refers to, and find the areas overlapping it. Only writes to the area, so areas can be
+	 * validated in parallel; return the ValidationError flags of what could not be resolved.
+	 */
+	std::uint8_t NavigationMap::Validate(NavArea* area) const {
+		std::uint8_t errors = 0;
+
+		// connect areas together
+		for (int d = 0; d < NUM_DIRECTIONS; d++) {
+			for (auto& connect : area->m_connect[d]) {
+				const std::uint32_t Id = connect.index;
+				connect.index = ResolveAreaID(Id);
+				if (Id && connect.index == Invalid_Index)
+					errors |= MISSING_CONNECTION;
+			}
+		}
+
+		// resolve approach area IDs
+		for (int a = 0; a < area->m_approachCount; ++a) {
+			for (NavConnect* connect : { &area->m_approach[a].here, &area->m_approach[a].prev, &area->m_approach[a].next }) {
+				const std::uint32_t Id = connect->index;
+				connect->index = ResolveAreaID(Id);
+				if (Id && connect->index == Invalid_Index)
+					errors |= MISSING_APPROACH;
+			}
+		}
+
+		// resolve spot encounter IDs
+		for (auto& e : area->encounter_spots) {
+			e.from.index = ResolveAreaID(e.from.index);
+			e.to.index = ResolveAreaID(e.to.index);
+			if (e.from.index == Invalid_Index || e.to.index == Invalid_Index)
+				errors |= MISSING_ENCOUNTER_AREA;
+
+			// resolve HidingSpot IDs
+			for (auto& order : e.spotList) {
+				order.spot = FindSpotIndex(order.spot);
+				if (order.spot == Invalid_Index)
+					errors |= MISSING_HIDING_SPOT;
+			}
+		}
+
+		// build overlap list, from the areas sharing a grid cell with this one, in the order they were read
+		std::vector<NavArea*> candidates;
+		m_navAreaGrid.ForEachAreaInCells(area->m_extent, [area, &candidates](NavArea* area2) {
+			if (area2 != area && area->IsOverlapping(area2))
+				candidates.push_back(area2);
+		});
+		std::sort(candidates.begin(), candidates.end(), [](const NavArea* a, const NavArea* b) { return a->m_index < b->m_index; });
+		candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+		area->m_overlapList.assign(candidates.begin(), candidates.end());
+		return errors;
+	}
+
+	void NavigationMap::PrintValidationErrors(std::uint8_t errors) {
+		if (errors & MISSING_CONNECTION)
+			Print("ERROR: Corrupt navigation data. Cannot connect Navigation Areas.\n");
+		if (errors & MISSING_APPROACH)
+			Print("ERROR: Corrupt navigation data. Missing Approach Area.\n");
+		if (errors & MISSING_ENCOUNTER_AREA)
+			Print("ERROR: Corrupt navigation data. Missing Navigation Area for Encounter Spot.\n");
+		if (errors & MISSING_HIDING_SPOT)
+			Print("ERROR: Corrupt navigation data. Missing Hiding Spot\n");
+	}
+
+	/**
+	 * Clear the grid
+	 */
+	void NavAreaGrid::Reset(void) {
+		if (m_grid)
+			delete[] m_grid;
+
+		m_grid = nullptr;
+		m_gridSizeX = 0;
+		m_gridSizeY = 0;
+
+		// clear the hash table
+		for (int i = 0; i < HASH_TABLE_SIZE; ++i)
+			m_hashTable[i] = nullptr;
+
+		m_areaCount = 0;
+	}
 
 	/**
 	 * Allocate the grid and define its extents
@@ -1250,6 +2839,22 @@ namespace navmesh {
 	/**
 	 * Add an area to the grid
 	 */
+	void NavAreaGrid::ForEachAreaInCells(const Extent& extent, const std::function<void(NavArea*)>& func) const {
+		if (m_grid == nullptr)
+			return;
+
+		const int Lo_X = WorldToGridX(extent.lo.x);
+		const int Lo_Y = WorldToGridY(extent.lo.y);
+		const int Hi_X = WorldToGridX(extent.hi.x);
+		const int Hi_Y = WorldToGridY(extent.hi.y);
+		for (int y = Lo_Y; y <= Hi_Y; ++y) {
+			for (int x = Lo_X; x <= Hi_X; ++x) {
+				for (auto& area : m_grid[x + y * m_gridSizeX])
+					func(area);
+			}
+		}
+	}
+
 	void NavAreaGrid::AddNavArea(NavArea* area) {
 		// add to grid
 		const Extent* extent = &area->m_extent;
@@ -1360,7 +2965,7 @@ namespace navmesh {
 		return use;
 	}
 
-	void NavigationMap::ForEachArea(std::function<void(const NavArea*)> func) {
+	void NavigationMap::ForEachArea(std::function<void(const NavArea*)> func) const {
 		for (auto& area : m_areas) {
 			func(area);
 		}
@@ -1370,13 +2975,30 @@ namespace navmesh {
 		return m_navAreaGrid.GetNavArea(pos);
 	}
 
+	NavArea* NavigationMap::GetNearestNavArea(const Vector* pos, bool anyZ) const {
+		return m_navAreaGrid.GetNearestNavArea(this, pos, anyZ);
+	}
+
+	Place NavigationMap::GetPlace(const Vector* pos) const {
+		return m_navAreaGrid.GetPlace(pos);
+	}
+
+	NavArea* NavigationMap::GetNavAreaByID(unsigned int id) const {
+		if (NavArea* area = m_navAreaGrid.GetNavAreaByID(id); area != nullptr)
+			return area;
+
+		// the area may have been merged into another one, see MergeAreas()
+		const auto Merged = m_mergedIDs.find(id);
+		return Merged != m_mergedIDs.end() ? m_navAreaGrid.GetNavAreaByID(Merged->second) : nullptr;
+	}
+
 	//--------------------------------------------------------------------------------------------------------------
 	/**
 	 * Given a position in the world, return the nav area that is closest
 	 * and at the same height, or beneath it.
 	 * Used to find initial area if we start off of the mesh.
 	 */
-	NavArea* NavAreaGrid::GetNearestNavArea(NavigationMap* mesh, const Vector* pos, bool anyZ) const {
+	NavArea* NavAreaGrid::GetNearestNavArea(const NavigationMap* mesh, const Vector* pos, bool anyZ) const {
 		if (m_grid == nullptr)
 			return nullptr;
 
@@ -1390,7 +3012,7 @@ namespace navmesh {
 		Vector source;
 		source.x = pos->x;
 		source.y = pos->y;
-		if (!GetGroundHeight(pos, &source.z))
+		if (!GetGroundHeight(pos, &source.z, nullptr, &mesh->GetGroundHeightCache()))
 			return nullptr;
 
 		source.z += HalfHumanHeight;
@@ -1443,15 +3065,53 @@ namespace navmesh {
 
 	//--------------------------------------------------------------------------------------------------------------
 	/**
-	 * Return radio chatter place for given coordinate
+	 * Return radio chatter place for given coordinate: the place of the area beneath it, or else of the closest area.
+	 * The cells are searched in rings around the position until no farther cell can hold a closer area.
 	 */
-	unsigned int NavAreaGrid::GetPlace(NavigationMap* mesh, const Vector* pos) const {
-		NavArea* area = GetNearestNavArea(mesh, pos, true);
+	Place NavAreaGrid::GetPlace(const Vector* pos) const {
+		if (m_grid == nullptr)
+			return Undefined_Place;
 
-		if (area)
+		if (const NavArea* area = GetNavArea(pos); area != nullptr)
 			return area->m_place;
 
-		return Undefined_Place;
+		const int Center_X = WorldToGridX(pos->x);
+		const int Center_Y = WorldToGridY(pos->y);
+		const NavArea* close = nullptr;
+		float closeDistSq = std::numeric_limits<float>::infinity();
+		auto search = [&](int x, int y) {
+			if (x < 0 || y < 0 || x >= m_gridSizeX || y >= m_gridSizeY)
+				return;
+
+			for (const NavArea* area : m_grid[x + y * m_gridSizeX]) {
+				Vector areaPos;
+				area->GetClosestPointOnArea(pos, &areaPos);
+				const Vector Delta = areaPos - *pos;
+				const float DistSq = DotProduct(Delta, Delta);
+				if (DistSq < closeDistSq) {
+					closeDistSq = DistSq;
+					close = area;
+				}
+			}
+		};
+
+		// every cell of ring r + 1 is at least r cells away from the position
+		const int Max_Ring = (std::max)(m_gridSizeX, m_gridSizeY);
+		for (int ring = 0; ring <= Max_Ring; ++ring) {
+			if (close != nullptr && closeDistSq <= (ring - 1) * m_cellSize * (ring - 1) * m_cellSize)
+				break;
+
+			for (int d = -ring; d <= ring; ++d) {
+				search(Center_X + d, Center_Y - ring);
+				if (ring > 0)
+					search(Center_X + d, Center_Y + ring);
+			}
+			for (int d = -ring + 1; d <= ring - 1; ++d) {
+				search(Center_X - ring, Center_Y + d);
+				search(Center_X + ring, Center_Y + d);
+			}
+		}
+		return close != nullptr ? close->m_place : Undefined_Place;
 	}
 
 
@@ -1468,7 +3128,163 @@ namespace navmesh {
 			delete* iter;
 
 		m_hidingSpots.clear();
+		m_spotByIndex.clear();
+	}
+
+	void NavigationMap::AddHidingSpots(HidingSpot* spot) {
+		if (m_nextSpotSlot != Invalid_Index) {
+			// a spot decoded lazily takes the index set aside for it, see IndexLazyRecords()
+			spot->m_index = m_nextSpotSlot++;
+			m_spotByIndex[spot->m_index] = spot;
+		} else {
+			spot->m_index = static_cast<std::uint32_t>(m_spotByIndex.size());
+			m_spotByIndex.push_back(spot);
+		}
+		m_hidingSpots.push_back(spot);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * Set aside the indices of the spots that were not decoded, in the order of the areas, as RenumberAreas()
+	 * would have numbered them, and index their IDs so encounters can be resolved without decoding the spots.
+	 */
+	void NavigationMap::IndexLazyRecords(const std::vector<std::pair<NavArea*, LazyRecord>>& records) {
+		const auto Area_Count = GetAreaCount();
+		m_lazyRecords.assign(Area_Count, LazyRecord{});
+		for (auto& [area, record] : records)
+			m_lazyRecords[area->m_index] = record;
+
+		m_spotStart.assign(Area_Count + 1, 0);
+		for (std::uint32_t i = 0; i < Area_Count; ++i)
+			m_spotStart[i + 1] = m_spotStart[i] + m_lazyRecords[i].spotCount;
+
+		m_spotIndexByID.clear();
+		m_spotIndexByID.reserve(m_spotStart.back());
+		for (std::uint32_t i = 0; i < Area_Count; ++i) {
+			for (std::uint32_t s = 0; s < m_lazyRecords[i].spotCount; ++s) {
+				const auto Id = ReadRecordField<std::uint32_t>(m_lazyBytes.data() + m_lazyRecords[i].spotOffset + s * Spot_Record_Size);
+				m_spotIndexByID.emplace_back(Id, m_spotStart[i] + s);
+
+				// update next ID to avoid ID collisions by later spots
+				if (Id >= HidingSpot::m_nextID)
+					HidingSpot::m_nextID = Id + 1;
+			}
+		}
+		std::sort(m_spotIndexByID.begin(), m_spotIndexByID.end());
+
+		m_spotByIndex.assign(m_spotStart.back(), nullptr);
+		m_decodedParts = std::make_unique<std::atomic<std::uint8_t>[]>(Area_Count);
 	}
 
-	void NavigationMap::AddHidingSpots(HidingSpot* spot) { m_hidingSpots.push_back(spot); }
+	/**
+	 * Make sure the given parts of an area are decoded. The first thread to ask decodes them; the others wait.
+	 */
+	void NavigationMap::Decode(std::uint32_t area, std::uint8_t parts) const {
+		if (m_decodedParts == nullptr || (m_decodedParts[area].load(std::memory_order_acquire) & parts) == parts)
+			return;
+
+		std::lock_guard lock(m_decodeMutex);
+		DecodeLocked(area, parts);
+	}
+
+	void NavigationMap::DecodeLocked(std::uint32_t area, std::uint8_t parts) const {
+		const std::uint8_t Decoded = m_decodedParts[area].load(std::memory_order_relaxed);
+		parts &= ~Decoded;
+		if (parts == 0)
+			return;
+
+		// filling in what the file already says is not a change anyone can see, so it is allowed on a const map
+		auto self = const_cast<NavigationMap*>(this);
+		NavArea* navArea = m_areaByIndex[area];
+		const LazyRecord& Record = m_lazyRecords[area];
+
+		if (parts & SPOTS_DECODED) {
+			self->m_nextSpotSlot = m_spotStart[area];
+			for (std::uint32_t s = 0; s < Record.spotCount; ++s) {
+				const std::uint8_t* bytes = m_lazyBytes.data() + Record.spotOffset + s * Spot_Record_Size;
+				HidingSpot* spot = new HidingSpot(self);
+				spot->m_id = ReadRecordField<std::uint32_t>(bytes);
+				spot->m_pos = ReadRecordField<Vector>(bytes + 4);
+				spot->m_flags = bytes[16];
+				navArea->hiding_spots.push_back(spot);
+			}
+			self->m_nextSpotSlot = Invalid_Index;
+		}
+
+		if (parts & ENCOUNTERS_DECODED) {
+			// resolved like Validate() does, leaving unknown references invalid
+			const std::uint8_t* bytes = m_lazyBytes.data() + Record.encounterOffset;
+			for (std::uint32_t e = 0; e < Record.encounterCount; ++e) {
+				SpotEncounter encounter;
+				encounter.from.index = ResolveAreaID(ReadRecordField<std::uint32_t>(bytes));
+				encounter.fromDir = static_cast<NavDirType>(bytes[4]);
+				encounter.to.index = ResolveAreaID(ReadRecordField<std::uint32_t>(bytes + 5));
+				encounter.toDir = static_cast<NavDirType>(bytes[9]);
+				const std::uint8_t Spot_Count = bytes[10];
+				bytes += Encounter_Record_Size;
+
+				for (int s = 0; s < Spot_Count; ++s, bytes += Encounter_Spot_Record_Size)
+					encounter.spotList.push_back({ (float)bytes[4] / 255.0f, FindSpotIndex(ReadRecordField<std::uint32_t>(bytes)) });
+
+				// before AttachToLevel() there are no portals yet, and BuildEncounterPaths() does it then
+				if (!m_linkStart.empty())
+					ComputeEncounterPath(navArea, &encounter);
+
+				navArea->encounter_spots.push_back(std::move(encounter));
+			}
+		}
+
+		m_decodedParts[area].store(Decoded | parts, std::memory_order_release);
+	}
+
+	void NavigationMap::DecodeAll() const {
+		if (m_decodedParts == nullptr)
+			return;
+
+		std::lock_guard lock(m_decodeMutex);
+		for (std::uint32_t i = 0; i < GetAreaCount(); ++i)
+			DecodeLocked(i, SPOTS_DECODED | ENCOUNTERS_DECODED);
+	}
+
+	/// forget the records kept for lazy decoding, once everything is decoded or the map is going away
+	void NavigationMap::ClearLazyDecoding() {
+		m_decodedParts.reset();
+		std::vector<std::uint8_t>().swap(m_lazyBytes);
+		std::vector<LazyRecord>().swap(m_lazyRecords);
+		std::vector<std::uint32_t>().swap(m_spotStart);
+		std::vector<std::pair<std::uint32_t, std::uint32_t>>().swap(m_spotIndexByID);
+	}
+
+	HidingSpot* NavigationMap::GetHidingSpotByIndex(std::uint32_t index) const {
+		if (m_decodedParts != nullptr) {
+			// the area owning the spot is the last one starting at or before it
+			const auto Owner = std::upper_bound(m_spotStart.begin(), m_spotStart.end(), index) - m_spotStart.begin() - 1;
+			Decode(static_cast<std::uint32_t>(Owner), SPOTS_DECODED);
+		}
+		return m_spotByIndex[index];
+	}
+
+	const std::list<HidingSpot*>& NavigationMap::GetHidingSpots(const NavArea* area) const {
+		Decode(area->m_index, SPOTS_DECODED);
+		return area->hiding_spots;
+	}
+
+	const std::list<SpotEncounter>& NavigationMap::GetSpotEncounters(const NavArea* area) const {
+		Decode(area->m_index, ENCOUNTERS_DECODED);
+		return area->encounter_spots;
+	}
+
+	const HidingSpotIndex& NavigationMap::GetHidingSpotIndex() const {
+		if (!m_hidingSpotIndexReady.load(std::memory_order_acquire) && m_decodedParts != nullptr) {
+			std::lock_guard lock(m_decodeMutex);
+			if (!m_hidingSpotIndexReady.load(std::memory_order_relaxed)) {
+				for (std::uint32_t i = 0; i < GetAreaCount(); ++i)
+					DecodeLocked(i, SPOTS_DECODED);
+
+				const_cast<HidingSpotIndex&>(m_hidingSpotIndex).Build(*this);
+				const_cast<std::atomic<bool>&>(m_hidingSpotIndexReady).store(true, std::memory_order_release);
+			}
+		}
+		return m_hidingSpotIndex;
+	}
 }
\ No newline at end of file
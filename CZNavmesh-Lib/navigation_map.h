@@ -18,8 +18,25 @@
 #include <meta_api.h>
 #include <entity_state.h>
 
+#include "area_blocking.h"
+#include "area_visibility.h"
+#include "engine_queue.h"
+#include "ground_height_cache.h"
+#include "hiding_spot_index.h"
+#include "nav_cache.h"
+#include "nav_image.h"
+#include "place_index.h"
+#include "place_names.h"
+
+#include <array>
+#include <atomic>
+#include <filesystem>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <functional>
 
@@ -30,25 +47,39 @@ namespace navmesh {
 	class HidingSpot;
 	class NavigationMap;
 
-	/**
-	 * A place is a named group of navigation areas
-	 */
-	using Place = std::uint32_t;
-	constexpr Place Undefined_Place = 0u;	// ie: "no place"
-	constexpr Place Any_Place = 0xFFFF;
-
 	struct Extent { Vector lo, hi; };
 	struct Ray { Vector from, to; };
 
+	constexpr std::uint32_t Invalid_Index = 0xFFFFFFFFu;	// ie: "no area" / "no link"
+
+	constexpr float GenerationStepSize = 25.0f;		// (30) was 20, but bots can't fit always fit
+	constexpr float StepHeight = 18.0f;						///< if delta Z is greater than this, we have to jump to get up
+	constexpr float JumpHeight = 41.8f;						///< if delta Z is less than this, we can jump up on it
+	constexpr float JumpCrouchHeight = 58.0f;			///< (48) if delta Z is less than or equal to this, we can jumpcrouch up on it
+
+	// Strictly speaking, you CAN get up a slope of 1.643 (about 59 degrees), but you move very, very slowly
+	// This slope will represent the slope you can navigate without much slowdown
+	constexpr float MaxSlope = 1.4f;							///< rise/run - if greater than this, we can't move up it (de_survivor canyon ramps)
+
+	// instead of MaxSlope, we are using the following max Z component of a unit normal
+	constexpr float MaxUnitZSlope = 0.7f;
+
+	constexpr float BotRadius = 10.0f;						///< circular extent that contains bot
+	constexpr float DeathDrop = 200.0f;						///< (300) distance at which we will die if we fall - should be about 600, and pay attention to fall damage during pathfind
+
+	constexpr float HalfHumanWidth = 16.0f;
+	constexpr float HalfHumanHeight = 36.0f;
+	constexpr float HumanHeight = 72.0f;
+
 	//-------------------------------------------------------------------------------------------------------------------
 	/**
-	* The NavConnect union is used to refer to connections to areas
-	*/
-	union NavConnect {
-		unsigned int id;
-		NavArea* area;
+	 * Refers to an area by its dense index in the NavigationMap, see NavigationMap::GetArea().
+	 * While the .nav file is read it holds the area ID instead, until Validate() resolves it.
+	 */
+	struct NavConnect {
+		std::uint32_t index{ Invalid_Index };
 
-		inline bool operator==(const NavConnect& other) const { return (area == other.area); }
+		inline bool operator==(const NavConnect& other) const { return (index == other.index); }
 	};
 
 
@@ -120,7 +151,17 @@ namespace navmesh {
 		NUM_CORNERS
 	};
 
+	/**
+	 * How a NavigationMap numbers its areas, see NavigationMap::SetAreaOrder()
+	 */
+	enum NavAreaOrderType {
+		FILE_AREA_ORDER,											///< as stored in the .nav file
+		HILBERT_AREA_ORDER,											///< along a Hilbert curve over the area centers
+		BFS_AREA_ORDER,												///< breadth first over the connections, components in Hilbert order
+	};
 
+	void AddDirectionVector(Vector* v, NavDirType dir, float amount);
+	void DirectionToVector2D(NavDirType dir, Vector2D* v);
 
 	//--------------------------------------------------------------------------------------------------------------
 	/**
@@ -128,6 +169,10 @@ namespace navmesh {
 	 */
 	class HidingSpot {
 	public:
+		/**
+		 * For use when loading in parallel - the map adds the spot itself, see NavigationMap::AddHidingSpots()
+		 */
+		HidingSpot();
 		HidingSpot(NavigationMap*);
 
 		/**
@@ -144,8 +189,9 @@ namespace navmesh {
 		unsigned int m_marker;									///< this spot's unique marker
 
 		unsigned char m_flags;									///< bit flags
+		std::uint32_t m_index;									///< dense index of this spot in its NavigationMap
 
-		inline static unsigned int m_nextID;							///< used when allocating spot ID's
+		inline static thread_local unsigned int m_nextID;				///< used when allocating spot ID's, per loading thread
 		inline static unsigned int m_masterMarker;						///< used to mark spots
 	};
 
@@ -155,10 +201,7 @@ namespace navmesh {
 	 */
 	struct SpotOrder {
 		float t;								///< parametric distance along ray where this spot first has LOS to our path
-		union {
-			HidingSpot* spot;					///< the spot to look at
-			unsigned int id;					///< spot ID for save/load
-		};
+		std::uint32_t spot;						///< dense index of the spot to look at, see NavigationMap::GetHidingSpot(); its ID while loading
 	};
 
 	/**
@@ -243,7 +286,7 @@ namespace navmesh {
 		float GetZ(const Vector* pos) const;
 		float GetZ(float x, float y) const;
 
-		static inline unsigned int m_nextID = 1;							///< used to allocate unique IDs
+		static inline thread_local unsigned int m_nextID = 1;				///< used to allocate unique IDs, per loading thread
 		//- approach areas ----------------------------------------------------------------------------------
 		struct ApproachInfo {
 			NavConnect here{};										///< the approach area
@@ -273,10 +316,10 @@ namespace navmesh {
 		float m_dangerTimestamp[MAX_AREA_TEAMS];			///< time when danger value was set - used for decaying
 
 		//- hiding spots ------------------------------------------------------------------------------------
-		std::list<HidingSpot*> hiding_spots;
+		std::list<HidingSpot*> hiding_spots;				///< empty until first use when decoded lazily, see NavigationMap::GetHidingSpots()
 
 		//- encounter spots ---------------------------------------------------------------------------------
-		std::list<SpotEncounter> encounter_spots;			///< list of possible ways to move thru this area, and the spots to look at as we do
+		std::list<SpotEncounter> encounter_spots;			///< list of possible ways to move thru this area, and the spots to look at as we do; see NavigationMap::GetSpotEncounters()
 
 		//- approach areas ----------------------------------------------------------------------------------
 		enum { MAX_APPROACH_AREAS = 16 };
@@ -307,6 +350,68 @@ namespace navmesh {
 		void OnDestroyNotify(NavArea* dead);					///< invoked when given area is going away
 
 		NavArea* m_prevHash, * m_nextHash;						///< for hash table in NavAreaGrid
+
+		std::uint32_t m_index{ Invalid_Index };					///< dense index of this area in its NavigationMap, assigned after loading
+	};
+
+	//-------------------------------------------------------------------------------------------------------------------
+	/**
+	 * A NavLink is a resolved, one-way connection from one area to another.
+	 * Links are built once after loading from m_connect and the ladders, and are addressed by their index.
+	 */
+	struct NavLink {
+		std::uint32_t from;										///< dense index of the area we leave
+		std::uint32_t to;										///< dense index of the area we enter
+		NavTraverseType how;									///< how we get from 'from' to 'to'
+		float length;											///< distance between the area centers
+	};
+
+	//-------------------------------------------------------------------------------------------------------------------
+	/**
+	 * A position as stored in the tables a NavImage holds. Vector has a user-provided copy constructor, so it is
+	 * not trivially copyable and cannot be stored there; this converts to it when read.
+	 */
+	struct ImagePoint {
+		float x, y, z;
+
+		static ImagePoint From(const Vector& v) noexcept { return { v.x, v.y, v.z }; }
+		operator Vector() const { return Vector(x, y, z); }
+	};
+
+	/// a Ray as stored in the tables a NavImage holds, see ImagePoint
+	struct ImageRay {
+		ImagePoint from, to;
+
+		static ImageRay From(const Ray& ray) noexcept { return { ImagePoint::From(ray.from), ImagePoint::From(ray.to) }; }
+		operator Ray() const { return { from, to }; }
+	};
+
+	//-------------------------------------------------------------------------------------------------------------------
+	/**
+	 * The opening a NavLink passes through, precomputed along with the links and stored at the same index.
+	 * For ladder links the opening is the point where the ladder is mounted, with no width.
+	 */
+	struct NavPortal {
+		ImagePoint center;										///< center of the opening, z is on the area we leave
+		float halfWidth;										///< half of the width of the opening
+		float leftZ;											///< height of the area we leave at the left end of the opening, as seen moving through it
+		float rightZ;											///< height of the area we leave at the right end of the opening
+		float toZ;												///< height of the area we enter at the center of the opening
+	};
+
+	//-------------------------------------------------------------------------------------------------------------------
+	/**
+	 * A SpotEncounter flattened for lookup by dense area indices.
+	 * The encounters of an area are stored together, sorted by (from, to), and their spots are packed in one array.
+	 */
+	struct NavEncounter {
+		std::uint32_t from;										///< dense index of the area we come from
+		std::uint32_t to;										///< dense index of the area we are heading to
+		NavDirType fromDir;
+		NavDirType toDir;
+		ImageRay path;											///< the path segment
+		std::uint32_t firstSpot;								///< first of the spots to look at, in order of occurrence
+		std::uint32_t spotCount;
 	};
 
 	/**
@@ -327,9 +432,18 @@ namespace navmesh {
 
 		NavArea* GetNavArea(const Vector* pos, float beneathLimt = 120.0f) const;	///< given a position, return the nav area that IsOverlapping and is *immediately* beneath it
 		NavArea* GetNavAreaByID(unsigned int id) const;
-		NavArea* GetNearestNavArea(NavigationMap*, const Vector* pos, bool anyZ = false) const;
+		NavArea* GetNearestNavArea(const NavigationMap*, const Vector* pos, bool anyZ = false) const;
+
+		/// call 'func' with every area in the cells 'extent' covers, once per cell
+		void ForEachAreaInCells(const Extent& extent, const std::function<void(NavArea*)>& func) const;
 
-		Place GetPlace(NavigationMap* mesh, const Vector* pos) const;				///< return radio chatter place for given coordinate
+		/**
+		 * Return the first i in [1, count] for which GetNavArea() finds an area at 'start' moved i * 'step' towards 'dir',
+		 * or 0 if there is none. Walks the cells along the way, instead of querying every step.
+		 */
+		int FindFirstStepOnArea(const Vector* start, NavDirType dir, float step, int count, float beneathLimit) const;
+
+		Place GetPlace(const Vector* pos) const;			///< return radio chatter place for given coordinate
 	private:
 		const float m_cellSize;
 		std::list<NavArea*>* m_grid;
@@ -349,17 +463,23 @@ namespace navmesh {
 	};
 
 	class PlaceDirectory {
-		std::vector<Place> m_directory;
 	public:
 		using EntryType = std::uint16_t;
 
+	private:
+		std::vector<Place> m_directory;							///< place of each entry, by entry - 1
+		std::array<EntryType, Max_Place + 1> m_entryOfPlace{};	///< first entry of each place, 0 if none
+
+	public:
 		void Reset();
 		bool IsKnown(Place place) const;
 		EntryType GetEntry(Place place) const;
 		void AddPlace(Place place);
+		void AddEntry(Place place);
 		Place EntryToPlace(EntryType entry) const;
 
 		inline void Reserve(size_t count) { m_directory.reserve(count); }
+		inline EntryType GetEntryCount() const { return static_cast<EntryType>(m_directory.size()); }
 	};
 
 	class NavigationMap {
@@ -368,20 +488,283 @@ namespace navmesh {
 		NavAreaGrid m_navAreaGrid{};
 		std::list<NavLadder*> m_navLadders{};
 		std::list<HidingSpot*> m_hidingSpots{};
+		std::vector<HidingSpot*> m_spotByIndex{};				///< spots addressed by HidingSpot::m_index
+
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> m_spotIndexByID{};	///< (ID, index) of every spot, by ID; only kept while needed
 
-		HidingSpot* GetHidingSpotByID(std::uint32_t id);
+		void IndexSpotIDs();
+		std::uint32_t FindSpotIndex(std::uint32_t id) const;
 		void DestroyHidingSpots();
 
-		void Validate(NavArea* area);
-		void BuildLadders();
+		//- area graph ----------------------------------------------------------------------------------------
+		std::vector<NavArea*> m_areaByIndex{};					///< areas addressed by NavArea::m_index
+		NavAreaOrderType m_areaOrder{ HILBERT_AREA_ORDER };		///< how LoadMesh() assigns NavArea::m_index
+		ImageArray<NavLink> m_links{};							///< outgoing links, grouped by 'from'
+		ImageArray<std::uint32_t> m_linkStart{};				///< first link of each area, plus one past the end
+		ImageArray<std::uint32_t> m_incomingStart{};			///< first entry of each area in m_incomingLinks, plus one past the end
+		ImageArray<std::uint32_t> m_incomingLinks{};			///< link indices grouped by 'to'
+		ImageArray<NavPortal> m_portals{};						///< opening of each link, addressed like m_links
+
+		//- spot encounters -----------------------------------------------------------------------------------
+		ImageArray<NavEncounter> m_encounters{};				///< grouped by area, then sorted by (from, to)
+		ImageArray<std::uint32_t> m_encounterStart{};			///< first encounter of each area, plus one past the end
+		ImageArray<SpotOrder> m_encounterSpots{};				///< spots of every encounter, addressed by NavEncounter::firstSpot
+		ImageArray<std::uint32_t> m_encounterTable{};			///< open addressing hash of (area, from, to) to encounter index
+
+		std::uint32_t m_generation{};							///< bumped whenever the map is destroyed or reloaded
+
+		AreaVisibility m_visibility{};
+		bool m_visibilityCulling{};								///< see SetVisibilityCulling()
+		HidingSpotIndex m_hidingSpotIndex{};
+		PlaceIndex m_placeIndex{};
+		mutable GroundHeightCache m_groundHeightCache{};		///< not part of the map's state; game thread only, like the traces it saves
+
+		EngineQueue* m_engine{};								///< where engine work goes while loading on another thread
+
+		//- source file ---------------------------------------------------------------------------------------
+		std::string m_path{};									///< the .nav file the mesh was loaded from
+		std::uint64_t m_fingerprint{};							///< hash of its contents, see FingerprintFile()
+		std::uintmax_t m_fileSize{};
+		std::filesystem::file_time_type m_fileTime{};
+		std::uint32_t m_savedBspSize{};							///< size of the .bsp the file was made for, zero if unknown
+		std::unique_ptr<NavCache> m_cache{};					///< read with the mesh, so attaching needs no file reads
+		std::unordered_map<std::uint32_t, std::uint32_t> m_mergedIDs{};	///< IDs of areas merged away, to the ID of the area holding them
+
+		//- shared image --------------------------------------------------------------------------------------
+		std::unique_ptr<NavImage> m_image{};					///< where the ImageArray members are viewed from, if any
+		bool m_imageSharing{ true };
+		bool m_ladderBuilding{ true };
+
+		//- lazy decoding -------------------------------------------------------------------------------------
+		/// where the hiding spots and encounters of an area are in m_lazyBytes
+		struct LazyRecord {
+			std::uint32_t spotOffset;
+			std::uint32_t spotCount;
+			std::uint32_t encounterOffset;
+			std::uint32_t encounterCount;
+		};
+
+		/// parts of an area decoded so far
+		enum DecodedPart : std::uint8_t {
+			SPOTS_DECODED = 0x01,
+			ENCOUNTERS_DECODED = 0x02,
+		};
+
+		bool m_lazyDecoding{};
+		std::vector<std::uint8_t> m_lazyBytes{};				///< the hiding spot and encounter records of the file, as read
+		std::vector<LazyRecord> m_lazyRecords{};				///< by area index
+		std::vector<std::uint32_t> m_spotStart{};				///< index of the first spot of each area, plus one past the end
+		std::unique_ptr<std::atomic<std::uint8_t>[]> m_decodedParts{};	///< DecodedPart flags by area index, nullptr when nothing is left to decode
+		std::atomic<bool> m_hidingSpotIndexReady{};
+		std::uint32_t m_nextSpotSlot{ Invalid_Index };			///< where AddHidingSpots() puts the spot being decoded, if anywhere
+		mutable std::mutex m_decodeMutex{};
+
+		bool RunOnGameThread(const std::function<void()>& job);
+		void Print(const char* message);
+		/// what Validate() could not resolve
+		enum ValidationError : std::uint8_t {
+			MISSING_CONNECTION = 0x01,
+			MISSING_APPROACH = 0x02,
+			MISSING_ENCOUNTER_AREA = 0x04,
+			MISSING_HIDING_SPOT = 0x08,
+		};
+
+		std::uint8_t Validate(NavArea* area) const;
+		void PrintValidationErrors(std::uint8_t errors);
+		bool BuildLadders(NavCache* cache);
+		void TraceLadder(NavLadder* ladder, edict_t* entity);
+		void AttachLadder(NavLadder* ladder);
+		void SaveLadders(NavCache* cache) const;
+		bool LoadLadders(const NavCache& cache, const std::vector<edict_t*>& entities);
 		void DestroyLadders();
+		void IndexAreas();
+		std::uint32_t ResolveAreaID(std::uint32_t id) const;
+		void OrderAreas();
+		void RenumberAreas(const std::vector<std::uint32_t>& oldIndex);
+		void BuildGrid();
+		void BuildAreaGraph();
+		void BuildEncounterPaths();
+		void ComputeEncounterPath(const NavArea* area, SpotEncounter* encounter) const;
+		void BuildEncounterIndex();
+		std::uint64_t GetLevelKey() const;
+		bool AttachImage(std::uint64_t levelKey);
+		bool AreImageIndicesValid() const;
+		void DropImage();
+		bool SaveImage(std::uint64_t levelKey) const;
+		void IndexLazyRecords(const std::vector<std::pair<NavArea*, LazyRecord>>& records);
+		void Decode(std::uint32_t area, std::uint8_t parts) const;
+		void DecodeLocked(std::uint32_t area, std::uint8_t parts) const;
+		void DecodeAll() const;
+		void ClearLazyDecoding();
 	public:
+		NavigationMap() = default;
+		NavigationMap(const NavigationMap&) = delete;
+		NavigationMap& operator=(const NavigationMap&) = delete;
+		~NavigationMap() { Destroy(); }
+
 		void Destroy();
-		void ForEachArea(std::function<void(const NavArea*)>);
+		void ForEachArea(std::function<void(const NavArea*)>) const;
 		NavArea* GetNavArea(const Vector* pos) const;
 
+		/// area closest to 'pos' when it is off the mesh, see NavAreaGrid::GetNearestNavArea(); game thread only
+		NavArea* GetNearestNavArea(const Vector* pos, bool anyZ = false) const;
+
+		/// place of the area under 'pos', or else of the closest area; makes no traces, so any thread may ask
+		Place GetPlace(const Vector* pos) const;
+		NavArea* GetNavAreaByID(unsigned int id) const;
+
+		//- area graph ----------------------------------------------------------------------------------------
+		std::uint32_t GetAreaCount() const noexcept { return static_cast<std::uint32_t>(m_areaByIndex.size()); }
+		NavArea* GetAreaByIndex(std::uint32_t index) const { return m_areaByIndex[index]; }
+		NavArea* GetArea(NavConnect connect) const { return connect.index != Invalid_Index ? m_areaByIndex[connect.index] : nullptr; }
+		const NavLink& GetLink(std::uint32_t link) const { return m_links[link]; }
+		std::uint32_t GetLinkIndex(const NavLink& link) const noexcept { return static_cast<std::uint32_t>(&link - m_links.data()); }
+		std::span<const NavLink> GetOutgoingLinks(std::uint32_t area) const;		///< links leaving the given area
+		std::span<const std::uint32_t> GetIncomingLinks(std::uint32_t area) const;	///< indices of the links entering the given area
+		std::uint32_t FindLink(std::uint32_t from, std::uint32_t to) const;			///< link between two areas preferring to walk, or Invalid_Index
+		const NavPortal& GetPortal(std::uint32_t link) const { return m_portals[link]; }
+
+		/**
+		 * Return the ends of the opening of a link, as seen when moving through it, pulled in by 'margin' on each side.
+		 */
+		void GetPortalEndpoints(std::uint32_t link, float margin, Vector* left, Vector* right) const;
+		float GetLinkCost(const NavLink& link, const AreaBlocking* blocking = nullptr) const noexcept;	///< cost of traversing the link, infinite if it enters an area 'blocking' disables
+		float GetHeuristicCost(std::uint32_t from, std::uint32_t to) const noexcept;	///< admissible estimate of the cost between two areas
+
+		/**
+		 * Return true if a bot can walk in a straight line from 'from' to 'to', using only the mesh.
+		 * The line is followed in 2D from the area under 'from', across the openings between areas, and fails where it
+		 * leaves the mesh, enters an area 'blocking' disables, meets a step higher than StepHeight, or ends above or below
+		 * the floor 'to' is on.
+		 * If the way is blocked, 'hitPos' receives the point where it is, and 'lastArea' the last area reached.
+		 */
+		bool IsWalkableLine(const Vector& from, const Vector& to, Vector* hitPos = nullptr, const NavArea** lastArea = nullptr, const AreaBlocking* blocking = nullptr) const;
+
+		//- spot encounters -----------------------------------------------------------------------------------
+		std::span<const NavEncounter> GetEncounters(std::uint32_t area) const;		///< every way through the given area
+		std::span<const SpotOrder> GetEncounterSpots(const NavEncounter& encounter) const { return { m_encounterSpots.data() + encounter.firstSpot, encounter.spotCount }; }
+
+		/**
+		 * Return the encounter for moving through 'area' from 'from' towards 'to', or nullptr if there is none.
+		 */
+		const NavEncounter* FindEncounter(std::uint32_t area, std::uint32_t from, std::uint32_t to) const;
+
+		/// bumped whenever the map is destroyed or reloaded; which areas are blocked is kept apart, see AreaBlocking
+		std::uint32_t GetGeneration() const noexcept { return m_generation; }
+
+		//- potential visibility ------------------------------------------------------------------------------
+		bool IsPotentiallyVisible(std::uint32_t from, std::uint32_t to) const { return m_visibility.IsPotentiallyVisible(from, to); }
+
+		/**
+		 * Return true if nothing blocks the line between two points. Game thread only, like the trace it makes.
+		 * With SetVisibilityCulling(), the trace is skipped and false returned when the potentially visible sets
+		 * say the areas below the points cannot see each other, which may be wrong, see AreaVisibility.
+		 */
+		bool IsLineOfSightClear(const Vector& from, const Vector& to, edict_t* ignore = nullptr) const;
+
+		/// whether IsLineOfSightClear() trusts the potentially visible sets to skip traces; off by default
+		void SetVisibilityCulling(bool enabled) noexcept { m_visibilityCulling = enabled; }
+		const AreaVisibility& GetVisibility() const noexcept { return m_visibility; }
+
+		//- hiding spot queries -------------------------------------------------------------------------------
+		std::uint32_t GetHidingSpotCount() const noexcept { return static_cast<std::uint32_t>(m_spotByIndex.size()); }
+		HidingSpot* GetHidingSpotByIndex(std::uint32_t index) const;
+		HidingSpot* GetHidingSpot(const SpotOrder& order) const { return order.spot != Invalid_Index ? GetHidingSpotByIndex(order.spot) : nullptr; }
+		const HidingSpotIndex& GetHidingSpotIndex() const;
+
+		/// the hiding spots and encounters of an area; decoded here on first use with SetLazyDecoding(), from any thread
+		const std::list<HidingSpot*>& GetHidingSpots(const NavArea* area) const;
+		const std::list<SpotEncounter>& GetSpotEncounters(const NavArea* area) const;
+
+		//- places --------------------------------------------------------------------------------------------
+		const PlaceIndex& GetPlaceIndex() const noexcept { return m_placeIndex; }
+
+		//- ground height -------------------------------------------------------------------------------------
+		GroundHeightCache& GetGroundHeightCache() const noexcept { return m_groundHeightCache; }
+
+		/**
+		 * Fill the ground height cache at the corners of every area, where most off-mesh queries end up.
+		 * Optional - it trades traces while loading for fewer traces later.
+		 */
+		void WarmGroundHeightCache();
+
 		NavArea* FindFirstAreaInDirection(const Vector* start, NavDirType dir, float range, float beneathLimit, edict_t* traceIgnore = nullptr, Vector* closePos = nullptr);
-		bool Load(const std::string& Path_To_Nav);
+
+		/**
+		 * Load the .nav file and build everything derived from it.
+		 * With an engine queue, every engine call is handed to the game thread through it, a slice at a time, so
+		 * the load can run on another thread while the game thread keeps running the queue. Only one map may be
+		 * loading at a time, and it must not be used by anyone else until Load() returns.
+		 */
+		bool Load(const std::string& Path_To_Nav, EngineQueue* engine = nullptr);
+
+		/**
+		 * The two halves of Load(). LoadMesh() reads the file and needs nothing from the level, so it can run
+		 * ahead of time, while another map is played. AttachToLevel() then builds what depends on the level's
+		 * entities, like the ladders, and may be called again on the next level played on the same map.
+		 */
+		bool LoadMesh(const std::string& Path_To_Nav, EngineQueue* engine = nullptr);
+		bool AttachToLevel(EngineQueue* engine = nullptr);
+
+		/**
+		 * How LoadMesh() numbers the areas, and so how every table indexed by area is laid out in memory. Areas
+		 * close in space, or in the graph, then share cache lines in searches and queries. Hilbert order by
+		 * default; it must be set before loading.
+		 */
+		void SetAreaOrder(NavAreaOrderType order) noexcept { m_areaOrder = order; }
+
+		//- source file ---------------------------------------------------------------------------------------
+		const std::string& GetPath() const noexcept { return m_path; }
+		std::uint64_t GetFingerprint() const noexcept { return m_fingerprint; }
+
+		/// return the file keeping the IDs of the areas merged away before the given .nav file was saved
+		static std::string GetMergedIDPathFor(const std::string& navPath) { return navPath + ".merged"; }
+
+		/**
+		 * Write the mesh as a version 5 .nav file, with the areas and hiding spots in their current order, so a
+		 * reordered mesh keeps its layout when loaded in file order, down to where its areas are allocated.
+		 * Ladders and everything built from the mesh are not part of the file.
+		 */
+		bool Save(const std::string& Path_To_Nav) const;
+
+		/**
+		 * Merge adjacent areas that together make a rectangle, with the same attributes and place and a surface going
+		 * through all their corners, until no more can be merged. The merged area keeps the ID of one of its parts
+		 * and takes over the connections, hiding spots, encounters and approaches of the others, whose IDs
+		 * GetNavAreaByID() keeps resolving; Save() keeps them in a file next to the new one, see GetMergedIDPathFor().
+		 * An offline step, for a mesh read with LoadMesh() and not attached to a level: the mesh no longer matches
+		 * its file afterwards, so it must be saved and loaded again to be used. Return how many areas were merged away.
+		 */
+		std::uint32_t MergeAreas();
+
+		/// return true if the .nav file still has the size and modification time it had when it was loaded
+		bool IsFileUnchanged() const;
+
+		/// approximate number of bytes used by the mesh and everything built from it, not counting a shared image
+		std::size_t GetMemoryUsage() const;
+
+		//- shared image --------------------------------------------------------------------------------------
+		/**
+		 * Whether AttachToLevel() maps the tables derived from the mesh from a NavImage next to the .nav file,
+		 * writing it first if no other process has. On by default; it must be set before loading.
+		 */
+		void SetImageSharing(bool enabled) noexcept { m_imageSharing = enabled; }
+
+		/**
+		 * Whether AttachToLevel() builds the ladders of the level, tracing them on the game thread and writing the
+		 * ladder cache next to the .nav file. Without them the map has no ladder links; this is for copies that are
+		 * only measured, like the benchmarks load. On by default; it must be set before loading.
+		 */
+		void SetLadderBuilding(bool enabled) noexcept { m_ladderBuilding = enabled; }
+
+		/**
+		 * Whether LoadMesh() keeps the hiding spots and encounters of each area as the bytes of their file records,
+		 * and decodes them the first time they are asked for, which also holds back the hiding spot index. Building
+		 * the tables of a new image needs them all, so this pays off once the image exists. Off by default; it
+		 * must be set before loading.
+		 */
+		void SetLazyDecoding(bool enabled) noexcept { m_lazyDecoding = enabled; }
+		const NavImage* GetImage() const noexcept { return m_image.get(); }
 		void AddHidingSpots(HidingSpot* spot);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "path_corridor.h"
+
+#include <algorithm>
+
+namespace navmesh {
+	void PathCorridor::Reset(NavSnapshot map, std::span<const std::uint32_t> path) {
+		m_path.assign(path.begin(), path.end());
+		m_cursor = 0;
+		m_epoch = map.GetEpoch();
+		m_generation = map->GetGeneration();
+	}
+
+	PathCorridor::UpdateResult PathCorridor::Update(NavSnapshot map, const Vector& pos) {
+		++m_stats.updates;
+
+		// area indices are meaningless on another map, or once this one has been loaded again
+		if (m_path.empty() || m_epoch != map.GetEpoch() || m_generation != map->GetGeneration()) {
+			++m_stats.replans;
+			return NEEDS_REPLAN;
+		}
+
+		// a door closed or something was blown up in front of us
+		if (m_cursor + 1 < m_path.size() && m_blocking != nullptr && !m_blocking->IsAreaEnabled(m_path[m_cursor + 1])) {
+			++m_stats.replans;
+			return NEEDS_REPLAN;
+		}
+
+		// in mid-air, or otherwise between areas - wait until we land somewhere
+		const NavArea* area = map->GetNavArea(&pos);
+		if (area == nullptr || area->m_index == m_path[m_cursor])
+			return ON_PATH;
+
+		if (Shift(area->m_index)) {
+			++m_stats.shifts;
+			return SHIFTED;
+		}
+
+		if (Rejoin(*map, area->m_index)) {
+			++m_stats.rejoins;
+			return REJOINED;
+		}
+
+		++m_stats.replans;
+		return NEEDS_REPLAN;
+	}
+
+	/**
+	 * Move the cursor to 'area' if it is on the corridor close to where we were.
+	 * Look ahead first, since being carried forward is the common case.
+	 */
+	bool PathCorridor::Shift(std::uint32_t area) {
+		const std::size_t last = (std::min)(m_path.size() - 1, m_cursor + Max_Shift);
+		for (std::size_t i = m_cursor + 1; i <= last; ++i) {
+			if (m_path[i] == area) {
+				m_cursor = i;
+				return true;
+			}
+		}
+
+		const std::size_t first = (m_cursor > Max_Shift) ? m_cursor - Max_Shift : 0;
+		for (std::size_t i = m_cursor; i-- > first;) {
+			if (m_path[i] == area) {
+				m_cursor = i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/// return where 'area' is on the corridor ahead of the cursor, or the size of the path if it is not
+	std::size_t PathCorridor::FindAhead(std::uint32_t area) const {
+		const std::size_t last = (std::min)(m_path.size() - 1, m_cursor + Max_Shift);
+		for (std::size_t i = last + 1; i-- > m_cursor;) {
+			if (m_path[i] == area)
+				return i;
+		}
+		return m_path.size();
+	}
+
+	/**
+	 * Breadth first search from 'area' for a way back onto the corridor, a few areas at most.
+	 * On success the detour replaces the part of the corridor we already passed.
+	 */
+	bool PathCorridor::Rejoin(const NavigationMap& map, std::uint32_t area) {
+		m_frontier.clear();
+		m_frontier.push_back({ area, Invalid_Index, 0 });
+
+		for (std::uint32_t head = 0; head < m_frontier.size(); ++head) {
+			const SearchNode node = m_frontier[head];
+
+			if (const std::size_t onPath = FindAhead(node.area); onPath < m_path.size()) {
+				// splice the detour in front of the rest of the corridor
+				m_splice.clear();
+				for (std::uint32_t at = m_frontier[head].parent; at != Invalid_Index; at = m_frontier[at].parent)
+					m_splice.push_back(m_frontier[at].area);
+				std::reverse(m_splice.begin(), m_splice.end());
+				m_splice.insert(m_splice.end(), m_path.begin() + onPath, m_path.end());
+
+				m_path.swap(m_splice);
+				m_cursor = 0;
+				return true;
+			}
+
+			if (node.depth == Max_Rejoin_Depth)
+				continue;
+
+			for (auto& link : map.GetOutgoingLinks(node.area)) {
+				if (m_blocking != nullptr && !m_blocking->IsAreaEnabled(link.to))
+					continue;
+
+				if (m_frontier.size() == Max_Rejoin_Areas)
+					break;
+
+				const bool Seen = std::any_of(m_frontier.begin(), m_frontier.end(), [&](const SearchNode& other) { return other.area == link.to; });
+				if (!Seen)
+					m_frontier.push_back({ link.to, head, node.depth + 1 });
+			}
+		}
+		return false;
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "nav_snapshots.h"
+#include "navigation_map.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace navmesh {
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * A PathCorridor follows an agent along a planned sequence of areas.
+	 * When the agent is pushed around it moves the current position along the corridor, and if the agent
+	 * leaves the corridor it tries a short local search to rejoin it before asking for a full replan.
+	 * Areas disabled by 'blocking', if given, are never entered.
+	 * The map is passed to every call rather than kept, since it can be replaced between two frames; a corridor
+	 * made on a snapshot of another epoch needs a replan.
+	 */
+	class PathCorridor {
+	public:
+		enum UpdateResult {
+			ON_PATH,											///< the agent is still in the current area
+			SHIFTED,											///< the agent moved forward or backward along the corridor
+			REJOINED,											///< the agent left the corridor, and a short detour back to it was spliced in
+			NEEDS_REPLAN,										///< the corridor cannot be followed from here
+		};
+
+		struct Stats {
+			std::uint32_t updates;
+			std::uint32_t shifts;
+			std::uint32_t rejoins;
+			std::uint32_t replans;
+		};
+
+		static constexpr std::uint32_t Max_Shift = 8;			///< how far along the corridor to look for the agent's area, either way
+		static constexpr std::uint32_t Max_Rejoin_Depth = 4;	///< how many areas a detour back onto the corridor may take
+		static constexpr std::uint32_t Max_Rejoin_Areas = 64;	///< how many areas the local search may visit
+
+		explicit PathCorridor(const AreaBlocking* blocking = nullptr) : m_blocking(blocking) { }
+
+		/// start following a new path on 'map', given as area indices from the agent's area to the goal
+		void Reset(NavSnapshot map, std::span<const std::uint32_t> path);
+
+		/// track the agent at 'pos' - call whenever it moves, with the snapshot read this frame
+		UpdateResult Update(NavSnapshot map, const Vector& pos);
+
+		bool IsEmpty() const noexcept { return m_path.empty(); }
+		std::uint32_t GetCurrentArea() const { return m_path[m_cursor]; }
+		std::uint32_t GetGoal() const { return m_path.back(); }
+		std::span<const std::uint32_t> GetRemaining() const { return { m_path.data() + m_cursor, m_path.size() - m_cursor }; }	///< the current area up to the goal
+		const Stats& GetStats() const noexcept { return m_stats; }
+
+	private:
+		struct SearchNode {
+			std::uint32_t area;
+			std::uint32_t parent;								///< index into m_frontier, Invalid_Index for the root
+			std::uint32_t depth;
+		};
+
+		const AreaBlocking* m_blocking;
+		std::uint64_t m_epoch{};								///< epoch of the snapshot the path was made on
+		std::uint32_t m_generation{};
+		std::vector<std::uint32_t> m_path{};
+		std::size_t m_cursor{};									///< index of the agent's area in m_path
+		std::vector<SearchNode> m_frontier{};					///< scratch for the local search
+		std::vector<std::uint32_t> m_splice{};					///< scratch for rebuilding the path
+		Stats m_stats{};
+
+		bool Shift(std::uint32_t area);
+		bool Rejoin(const NavigationMap& map, std::uint32_t area);
+		std::size_t FindAhead(std::uint32_t area) const;
+	};
+}
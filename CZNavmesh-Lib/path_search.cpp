@@ -0,0 +1,362 @@
+#include "path_search.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace navmesh {
+	namespace {
+		constexpr float Infinite_Cost = std::numeric_limits<float>::infinity();
+	}
+
+	//--------------------------------------------------------------------------------------------------------------
+	void PathSearch::Prepare(std::uint32_t areaCount) {
+		if (m_seen.size() != areaCount) {
+			m_costSoFar.assign(areaCount, 0.0f);
+			m_parent.assign(areaCount, Invalid_Index);
+			m_seen.assign(areaCount, 0);
+			m_closed.assign(areaCount, 0);
+			m_open.Reset(areaCount);
+
+			m_costToGoal.assign(areaCount, 0.0f);
+			m_child.assign(areaCount, Invalid_Index);
+			m_seenBackward.assign(areaCount, 0);
+			m_closedBackward.assign(areaCount, 0);
+			m_openBackward.Reset(areaCount);
+			m_stamp = 0;
+		} else {
+			m_open.Clear();
+			m_openBackward.Clear();
+		}
+
+		// stamps let us skip clearing the per-area arrays between searches
+		if (++m_stamp == 0) {
+			std::fill(m_seen.begin(), m_seen.end(), 0);
+			std::fill(m_closed.begin(), m_closed.end(), 0);
+			std::fill(m_seenBackward.begin(), m_seenBackward.end(), 0);
+			std::fill(m_closedBackward.begin(), m_closedBackward.end(), 0);
+			m_stamp = 1;
+		}
+		m_expanded = 0;
+	}
+
+	bool PathSearch::Find(const NavigationMap& map, std::uint32_t start, std::uint32_t goal, std::vector<std::uint32_t>* path, const AreaBlocking* blocking) {
+		const auto Area_Count = map.GetAreaCount();
+		if (start >= Area_Count || goal >= Area_Count)
+			return false;
+
+		Prepare(Area_Count);
+
+		m_costSoFar[start] = 0.0f;
+		m_parent[start] = Invalid_Index;
+		m_seen[start] = m_stamp;
+		m_open.Push(start, map.GetHeuristicCost(start, goal));
+
+		while (!m_open.IsEmpty()) {
+			const std::uint32_t area = m_open.Pop();
+			m_closed[area] = m_stamp;
+			++m_expanded;
+
+			if (area == goal) {
+				if (path) {
+					path->clear();
+					for (std::uint32_t at = goal; at != Invalid_Index; at = m_parent[at])
+						path->push_back(at);
+					std::reverse(path->begin(), path->end());
+				}
+				return true;
+			}
+
+			for (auto& link : map.GetOutgoingLinks(area)) {
+				if (m_closed[link.to] == m_stamp)
+					continue;
+
+				const float cost = map.GetLinkCost(link, blocking);
+				if (cost == Infinite_Cost)
+					continue;
+
+				const float costSoFar = m_costSoFar[area] + cost;
+				if (m_seen[link.to] == m_stamp && costSoFar >= m_costSoFar[link.to])
+					continue;
+
+				m_seen[link.to] = m_stamp;
+				m_costSoFar[link.to] = costSoFar;
+				m_parent[link.to] = area;
+				m_open.Push(link.to, costSoFar + map.GetHeuristicCost(link.to, goal));
+			}
+		}
+		return false;
+	}
+
+	bool PathSearch::FindBidirectional(const NavigationMap& map, std::uint32_t start, std::uint32_t goal, std::vector<std::uint32_t>* path, const AreaBlocking* blocking) {
+		const auto Area_Count = map.GetAreaCount();
+		if (start >= Area_Count || goal >= Area_Count)
+			return false;
+
+		Prepare(Area_Count);
+
+		// Averaging the heuristics towards the goal and back to the start gives both halves the same reduced
+		// edge costs, so they behave like one Dijkstra search run from both ends
+		auto potential = [&](std::uint32_t area) {
+			return (map.GetHeuristicCost(area, goal) - map.GetHeuristicCost(start, area)) / 2.0f;
+		};
+
+		m_costSoFar[start] = 0.0f;
+		m_parent[start] = Invalid_Index;
+		m_seen[start] = m_stamp;
+		m_open.Push(start, potential(start));
+
+		m_costToGoal[goal] = 0.0f;
+		m_child[goal] = Invalid_Index;
+		m_seenBackward[goal] = m_stamp;
+		m_openBackward.Push(goal, -potential(goal));
+
+		float best = (start == goal) ? 0.0f : Infinite_Cost;
+		std::uint32_t meet = (start == goal) ? start : Invalid_Index;
+
+		while (!m_open.IsEmpty() && !m_openBackward.IsEmpty()) {
+			// nothing left in either queue can improve on the best meeting point
+			if (m_open.TopKey() + m_openBackward.TopKey() >= best)
+				break;
+
+			++m_expanded;
+			if (m_open.TopKey() <= m_openBackward.TopKey()) {
+				const std::uint32_t area = m_open.Pop();
+				m_closed[area] = m_stamp;
+
+				for (auto& link : map.GetOutgoingLinks(area)) {
+					const float cost = map.GetLinkCost(link, blocking);
+					if (cost == Infinite_Cost || m_closed[link.to] == m_stamp)
+						continue;
+
+					const float costSoFar = m_costSoFar[area] + cost;
+					if (m_seen[link.to] != m_stamp || costSoFar < m_costSoFar[link.to]) {
+						m_seen[link.to] = m_stamp;
+						m_costSoFar[link.to] = costSoFar;
+						m_parent[link.to] = area;
+						m_open.Push(link.to, costSoFar + potential(link.to));
+					}
+
+					if (m_seenBackward[link.to] == m_stamp && m_costSoFar[link.to] + m_costToGoal[link.to] < best) {
+						best = m_costSoFar[link.to] + m_costToGoal[link.to];
+						meet = link.to;
+					}
+				}
+			} else {
+				const std::uint32_t area = m_openBackward.Pop();
+				m_closedBackward[area] = m_stamp;
+
+				for (auto linkIndex : map.GetIncomingLinks(area)) {
+					const NavLink& link = map.GetLink(linkIndex);
+					const float cost = map.GetLinkCost(link, blocking);
+					if (cost == Infinite_Cost || m_closedBackward[link.from] == m_stamp)
+						continue;
+
+					const float costToGoal = m_costToGoal[area] + cost;
+					if (m_seenBackward[link.from] != m_stamp || costToGoal < m_costToGoal[link.from]) {
+						m_seenBackward[link.from] = m_stamp;
+						m_costToGoal[link.from] = costToGoal;
+						m_child[link.from] = area;
+						m_openBackward.Push(link.from, costToGoal - potential(link.from));
+					}
+
+					if (m_seen[link.from] == m_stamp && m_costSoFar[link.from] + m_costToGoal[link.from] < best) {
+						best = m_costSoFar[link.from] + m_costToGoal[link.from];
+						meet = link.from;
+					}
+				}
+			}
+		}
+
+		if (meet == Invalid_Index)
+			return false;
+
+		if (path) {
+			path->clear();
+			for (std::uint32_t at = meet; at != Invalid_Index; at = m_parent[at])
+				path->push_back(at);
+			std::reverse(path->begin(), path->end());
+
+			for (std::uint32_t at = m_child[meet]; at != Invalid_Index; at = m_child[at])
+				path->push_back(at);
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------
+	IncrementalPathPlanner::Key IncrementalPathPlanner::CalculateKey(const NavigationMap& map, std::uint32_t area) const {
+		const float best = (std::min)(m_g[area], m_rhs[area]);
+		return { best + map.GetHeuristicCost(m_start, area) + m_km, best };
+	}
+
+	float IncrementalPathPlanner::GetBestSuccessorCost(const NavigationMap& map, std::uint32_t area) const {
+		float best = Infinite_Cost;
+		for (auto& link : map.GetOutgoingLinks(area))
+			best = (std::min)(best, map.GetLinkCost(link, m_blocking) + m_g[link.to]);
+
+		return best;
+	}
+
+	void IncrementalPathPlanner::UpdateVertex(const NavigationMap& map, std::uint32_t area) {
+		if (m_g[area] != m_rhs[area])
+			m_open.Push(area, CalculateKey(map, area));
+		else
+			m_open.Remove(area);
+	}
+
+	void IncrementalPathPlanner::ComputeShortestPath(const NavigationMap& map) {
+		m_expanded = 0;
+		while (!m_open.IsEmpty() && (m_open.TopKey() < CalculateKey(map, m_start) || m_rhs[m_start] > m_g[m_start])) {
+			const std::uint32_t area = m_open.Top();
+			const Key oldKey = m_open.TopKey();
+			const Key newKey = CalculateKey(map, area);
+			++m_expanded;
+
+			if (oldKey < newKey) {
+				// the agent moved since this area was queued - requeue with an up to date key
+				m_open.Push(area, newKey);
+			} else if (m_g[area] > m_rhs[area]) {
+				// overconsistent: settle the area and relax its predecessors
+				m_g[area] = m_rhs[area];
+				m_open.Remove(area);
+
+				for (auto linkIndex : map.GetIncomingLinks(area)) {
+					const NavLink& link = map.GetLink(linkIndex);
+					if (link.from == m_goal)
+						continue;
+
+					m_rhs[link.from] = (std::min)(m_rhs[link.from], map.GetLinkCost(link, m_blocking) + m_g[area]);
+					UpdateVertex(map, link.from);
+				}
+			} else {
+				// underconsistent: the area got more expensive, so anything that relied on it must look again
+				const float oldG = m_g[area];
+				m_g[area] = Infinite_Cost;
+
+				for (auto linkIndex : map.GetIncomingLinks(area)) {
+					const NavLink& link = map.GetLink(linkIndex);
+					if (link.from == m_goal)
+						continue;
+
+					if (m_rhs[link.from] == map.GetLinkCost(link, m_blocking) + oldG)
+						m_rhs[link.from] = GetBestSuccessorCost(map, link.from);
+					UpdateVertex(map, link.from);
+				}
+
+				if (area != m_goal)
+					m_rhs[area] = GetBestSuccessorCost(map, area);
+				UpdateVertex(map, area);
+			}
+		}
+	}
+
+	bool IncrementalPathPlanner::IsReachable() const {
+		return m_rhs[m_start] != Infinite_Cost;
+	}
+
+	bool IncrementalPathPlanner::IsPlannedOn(NavSnapshot map) const {
+		// the epoch tells published maps apart, the generation an unpublished one loaded again in place
+		return m_goal != Invalid_Index && m_epoch == map.GetEpoch() && m_generation == map->GetGeneration() && m_g.size() == map->GetAreaCount();
+	}
+
+	bool IncrementalPathPlanner::Plan(NavSnapshot map, std::uint32_t start, std::uint32_t goal) {
+		const auto Area_Count = map->GetAreaCount();
+		if (start >= Area_Count || goal >= Area_Count) {
+			m_goal = Invalid_Index;
+			return false;
+		}
+
+		m_epoch = map.GetEpoch();
+		m_generation = map->GetGeneration();
+		m_changeCursor = m_blocking->GetChangeCount();
+		m_start = start;
+		m_goal = goal;
+		m_last = start;
+		m_km = 0.0f;
+
+		m_g.assign(Area_Count, Infinite_Cost);
+		m_rhs.assign(Area_Count, Infinite_Cost);
+		m_open.Reset(Area_Count);
+
+		m_rhs[goal] = 0.0f;
+		m_open.Push(goal, CalculateKey(*map, goal));
+		ComputeShortestPath(*map);
+
+		++m_stats.fullPlans;
+		m_stats.fullExpanded += m_expanded;
+		return IsReachable();
+	}
+
+	bool IncrementalPathPlanner::Replan(NavSnapshot map, std::uint32_t start) {
+		if (m_goal == Invalid_Index)
+			return false;
+
+		// the changes since the last call are gone from the log if too many were made
+		if (!IsPlannedOn(map) || m_changeCursor < m_blocking->GetFirstChange())
+			return Plan(map, start, m_goal);
+
+		if (start >= map->GetAreaCount())
+			return false;
+
+		// shift the keys rather than rebuilding the queue when the agent moves
+		if (start != m_last) {
+			m_km += map->GetHeuristicCost(m_last, start);
+			m_last = start;
+		}
+		m_start = start;
+
+		// entering a changed area costs something different now - reconsider every area leading into it
+		const auto Change_Count = m_blocking->GetChangeCount();
+		for (; m_changeCursor < Change_Count; ++m_changeCursor) {
+			const std::uint32_t changed = m_blocking->GetChange(m_changeCursor);
+			if (changed >= map->GetAreaCount())
+				continue;
+
+			for (auto linkIndex : map->GetIncomingLinks(changed)) {
+				const std::uint32_t from = map->GetLink(linkIndex).from;
+				if (from == m_goal)
+					continue;
+
+				m_rhs[from] = GetBestSuccessorCost(*map, from);
+				UpdateVertex(*map, from);
+			}
+		}
+
+		ComputeShortestPath(*map);
+
+		++m_stats.repairs;
+		m_stats.repairExpanded += m_expanded;
+		return IsReachable();
+	}
+
+	bool IncrementalPathPlanner::GetPath(NavSnapshot map, std::vector<std::uint32_t>* path) const {
+		if (!IsPlannedOn(map) || !IsReachable())
+			return false;
+
+		path->clear();
+		path->push_back(m_start);
+
+		// follow the cheapest successor - bounded in case the costs changed since the last repair
+		const auto Area_Count = map->GetAreaCount();
+		for (std::uint32_t area = m_start; area != m_goal;) {
+			if (path->size() > Area_Count)
+				return false;
+
+			std::uint32_t next = Invalid_Index;
+			float best = Infinite_Cost;
+			for (auto& link : map->GetOutgoingLinks(area)) {
+				const float cost = map->GetLinkCost(link, m_blocking) + m_g[link.to];
+				if (cost < best) {
+					best = cost;
+					next = link.to;
+				}
+			}
+
+			if (next == Invalid_Index)
+				return false;
+
+			path->push_back(next);
+			area = next;
+		}
+		return true;
+	}
+}
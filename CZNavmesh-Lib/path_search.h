@@ -0,0 +1,227 @@
+#pragma once
+#include "nav_snapshots.h"
+#include "navigation_map.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace navmesh {
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * A binary min-heap of area indices.
+	 * Unlike std::priority_queue, the key of an area already in the heap can be changed or removed.
+	 */
+	template<typename Key>
+	class AreaHeap {
+		struct Entry {
+			Key key;
+			std::uint32_t area;
+		};
+
+		std::vector<Entry> m_heap{};
+		std::vector<std::uint32_t> m_position{};				///< slot of each area in m_heap, Invalid_Index if not queued
+
+		void Place(std::uint32_t slot, const Entry& entry) {
+			m_heap[slot] = entry;
+			m_position[entry.area] = slot;
+		}
+
+		void SiftUp(std::uint32_t slot) {
+			const Entry entry = m_heap[slot];
+			while (slot > 0) {
+				const std::uint32_t parent = (slot - 1) / 2;
+				if (!(entry.key < m_heap[parent].key))
+					break;
+
+				Place(slot, m_heap[parent]);
+				slot = parent;
+			}
+			Place(slot, entry);
+		}
+
+		void SiftDown(std::uint32_t slot) {
+			const Entry entry = m_heap[slot];
+			const auto Size = static_cast<std::uint32_t>(m_heap.size());
+			for (;;) {
+				std::uint32_t child = 2 * slot + 1;
+				if (child >= Size)
+					break;
+
+				if (child + 1 < Size && m_heap[child + 1].key < m_heap[child].key)
+					++child;
+
+				if (!(m_heap[child].key < entry.key))
+					break;
+
+				Place(slot, m_heap[child]);
+				slot = child;
+			}
+			Place(slot, entry);
+		}
+
+	public:
+		/// empty the heap and size it for the given number of areas
+		void Reset(std::uint32_t areaCount) {
+			m_heap.clear();
+			m_position.assign(areaCount, Invalid_Index);
+		}
+
+		/// empty the heap, touching only the queued areas
+		void Clear() {
+			for (auto& entry : m_heap)
+				m_position[entry.area] = Invalid_Index;
+			m_heap.clear();
+		}
+
+		bool IsEmpty() const noexcept { return m_heap.empty(); }
+		bool Contains(std::uint32_t area) const noexcept { return m_position[area] != Invalid_Index; }
+		std::uint32_t Top() const { return m_heap.front().area; }
+		const Key& TopKey() const { return m_heap.front().key; }
+
+		/// insert the area, or move it if it is already queued
+		void Push(std::uint32_t area, const Key& key) {
+			if (std::uint32_t slot = m_position[area]; slot != Invalid_Index) {
+				const bool Decreased = key < m_heap[slot].key;
+				m_heap[slot].key = key;
+				if (Decreased)
+					SiftUp(slot);
+				else
+					SiftDown(slot);
+				return;
+			}
+
+			m_heap.push_back({ key, area });
+			SiftUp(static_cast<std::uint32_t>(m_heap.size() - 1));
+		}
+
+		void Remove(std::uint32_t area) {
+			const std::uint32_t slot = m_position[area];
+			if (slot == Invalid_Index)
+				return;
+
+			m_position[area] = Invalid_Index;
+			const Entry last = m_heap.back();
+			m_heap.pop_back();
+			if (slot == m_heap.size())
+				return;
+
+			Place(slot, last);
+			SiftUp(slot);
+			SiftDown(m_position[last.area]);
+		}
+
+		std::uint32_t Pop() {
+			const std::uint32_t area = Top();
+			Remove(area);
+			return area;
+		}
+	};
+
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * Plain A* over the area graph of a NavigationMap.
+	 * Keeps its own scratch memory, so each searching thread or agent should own one.
+	 */
+	class PathSearch {
+		std::vector<float> m_costSoFar{};
+		std::vector<std::uint32_t> m_parent{};
+		std::vector<std::uint32_t> m_seen{};					///< equals m_stamp if the area was reached by this search
+		std::vector<std::uint32_t> m_closed{};					///< equals m_stamp if the area was expanded by this search
+		std::uint32_t m_stamp{};
+		AreaHeap<float> m_open{};
+		std::uint32_t m_expanded{};
+
+		//- backward half of the bidirectional search ---------------------------------------------------------
+		std::vector<float> m_costToGoal{};
+		std::vector<std::uint32_t> m_child{};					///< the area after this one on the way to the goal
+		std::vector<std::uint32_t> m_seenBackward{};
+		std::vector<std::uint32_t> m_closedBackward{};
+		AreaHeap<float> m_openBackward{};
+
+		void Prepare(std::uint32_t areaCount);
+	public:
+		/**
+		 * Find the cheapest path between two areas.
+		 * On success 'path' holds the area indices from 'start' to 'goal', inclusive. Areas 'blocking' disables are avoided.
+		 */
+		bool Find(const NavigationMap& map, std::uint32_t start, std::uint32_t goal, std::vector<std::uint32_t>* path, const AreaBlocking* blocking = nullptr);
+
+		/**
+		 * Same as Find(), but searches forward from 'start' and backward from 'goal' at the same time, following
+		 * one-way links backwards through the map's incoming link index.
+		 * Both halves are guided by the average of the two heuristics, which keeps the stopping rule exact:
+		 * the search ends once the two smallest queued keys add up to the best path found where they met.
+		 */
+		bool FindBidirectional(const NavigationMap& map, std::uint32_t start, std::uint32_t goal, std::vector<std::uint32_t>* path, const AreaBlocking* blocking = nullptr);
+
+		/// number of areas expanded by the last Find() or FindBidirectional()
+		std::uint32_t GetExpandedCount() const noexcept { return m_expanded; }
+	};
+
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * D* Lite planner for a single agent.
+	 * The search runs backwards from the goal, so when areas are enabled or disabled only the part of the
+	 * search tree whose costs changed is repaired, instead of planning again from scratch.
+	 * Which areas are disabled, and what changed, comes from an AreaBlocking that must outlive the planner.
+	 * The map is passed to every call rather than kept, since it can be replaced between two frames; a search made
+	 * on a snapshot of another epoch is dropped and planned again.
+	 */
+	class IncrementalPathPlanner {
+	public:
+		struct Stats {
+			std::uint32_t fullPlans;							///< number of searches started from scratch
+			std::uint32_t repairs;								///< number of incremental repairs
+			std::uint64_t fullExpanded;							///< areas expanded by all full plans
+			std::uint64_t repairExpanded;						///< areas expanded by all repairs
+		};
+
+		explicit IncrementalPathPlanner(const AreaBlocking* blocking) : m_blocking(blocking) { }
+
+		/**
+		 * Discard any previous search and plan from 'start' to 'goal'.
+		 * Return false if the goal cannot be reached.
+		 */
+		bool Plan(NavSnapshot map, std::uint32_t start, std::uint32_t goal);
+
+		/**
+		 * The agent is now in area 'start'. Apply the area changes logged since the last call and repair the search.
+		 * Falls back to Plan() if 'map' is not the one the search was made on, or the log has dropped some of those changes.
+		 * Return false if the goal cannot be reached.
+		 */
+		bool Replan(NavSnapshot map, std::uint32_t start);
+
+		/// build the current best path from the agent's area to the goal, inclusive; fails if 'map' has been replaced since
+		bool GetPath(NavSnapshot map, std::vector<std::uint32_t>* path) const;
+
+		std::uint32_t GetGoal() const noexcept { return m_goal; }
+		std::uint32_t GetLastExpandedCount() const noexcept { return m_expanded; }	///< areas expanded by the last Plan() or Replan()
+		const Stats& GetStats() const noexcept { return m_stats; }
+
+	private:
+		using Key = std::pair<float, float>;
+
+		const AreaBlocking* m_blocking;
+		std::uint64_t m_epoch{};								///< epoch of the snapshot the search was made on
+		std::uint32_t m_generation{};
+		std::uint32_t m_changeCursor{};							///< next change of m_blocking to apply
+		std::uint32_t m_start{ Invalid_Index };
+		std::uint32_t m_goal{ Invalid_Index };
+		std::uint32_t m_last{ Invalid_Index };					///< where the agent was when the key modifier was last updated
+		float m_km{};											///< key modifier, accumulates heuristic drift as the agent moves
+
+		std::vector<float> m_g{};								///< cost to goal as of the last expansion
+		std::vector<float> m_rhs{};							///< one-step lookahead cost to goal
+		AreaHeap<Key> m_open{};
+		std::uint32_t m_expanded{};
+		Stats m_stats{};
+
+		Key CalculateKey(const NavigationMap& map, std::uint32_t area) const;
+		float GetBestSuccessorCost(const NavigationMap& map, std::uint32_t area) const;
+		void UpdateVertex(const NavigationMap& map, std::uint32_t area);
+		void ComputeShortestPath(const NavigationMap& map);
+		bool IsReachable() const;
+		bool IsPlannedOn(NavSnapshot map) const;
+	};
+}
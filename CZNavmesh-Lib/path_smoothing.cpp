@@ -0,0 +1,146 @@
+#include "path_smoothing.h"
+
+#include <cmath>
+
+namespace navmesh {
+	namespace {
+		/// the opening between two areas, as seen when moving through it
+		struct Portal {
+			Vector left;
+			Vector right;
+		};
+
+		/// writes points into the caller's buffer, dropping repeated points and anything past the end
+		struct WaypointWriter {
+			std::span<Vector> buffer;
+			std::size_t count{};
+
+			void Append(const Vector& point) {
+				if (count > 0 && buffer[count - 1] == point)
+					return;
+
+				if (count < buffer.size())
+					buffer[count++] = point;
+			}
+		};
+
+		/// twice the signed area of the triangle (origin, a, b) - positive if b is counter-clockwise of a
+		float Cross2D(const Vector& origin, const Vector& a, const Vector& b) noexcept {
+			return (a.x - origin.x) * (b.y - origin.y) - (a.y - origin.y) * (b.x - origin.x);
+		}
+
+		bool Equal2D(const Vector& a, const Vector& b) noexcept {
+			return a.x == b.x && a.y == b.y;
+		}
+
+		Portal GetPortal(const NavigationMap& map, std::uint32_t link) {
+			// keep our distance from the walls on either side of the opening
+			Portal portal;
+			map.GetPortalEndpoints(link, BotRadius, &portal.left, &portal.right);
+			return portal;
+		}
+
+		/**
+		 * If the link cannot be smoothed across, return true and the points where the transition starts and ends.
+		 */
+		bool GetForcedTransition(const NavigationMap& map, std::uint32_t linkIndex, Vector* entry, Vector* exit) {
+			const NavLink& link = map.GetLink(linkIndex);
+			const NavPortal& portal = map.GetPortal(linkIndex);
+
+			// ladders have to be climbed from end to end, and jumps and drops taken at the opening itself
+			if (link.how < GO_LADDER_UP) {
+				const NavArea* to = map.GetAreaByIndex(link.to);
+				if ((to->m_attributeFlags & NAV_JUMP) == 0 && std::fabs(portal.toZ - portal.center.z) <= StepHeight)
+					return false;
+			}
+
+			*entry = portal.center;
+			*exit = Vector(portal.center.x, portal.center.y, portal.toZ);
+			return true;
+		}
+
+		/**
+		 * Pull a string from 'from' through the portals entering corridor[first] .. corridor[last], and on to 'to'.
+		 * Every corner of the string after 'from' is written, including 'to'.
+		 */
+		void StringPull(const NavigationMap& map, std::span<const std::uint32_t> corridor, std::size_t first, std::size_t last, const Vector& from, const Vector& to, WaypointWriter* out) {
+			Vector apex = from, funnelLeft = from, funnelRight = from;
+			std::size_t apexIndex = first - 1, leftIndex = apexIndex, rightIndex = apexIndex;
+
+			for (std::size_t i = first; i <= last + 1; ++i) {
+				Portal portal{ to, to };
+				if (i <= last)
+					portal = GetPortal(map, map.FindLink(corridor[i - 1], corridor[i]));
+
+				// try to narrow the right side of the funnel
+				if (Cross2D(apex, funnelRight, portal.right) >= 0.0f) {
+					if (Equal2D(apex, funnelRight) || Cross2D(apex, funnelLeft, portal.right) <= 0.0f) {
+						funnelRight = portal.right;
+						rightIndex = i;
+					} else {
+						// the right side crossed over the left - the left corner is on the path
+						apex = funnelLeft;
+						apexIndex = leftIndex;
+						out->Append(apex);
+
+						funnelLeft = funnelRight = apex;
+						leftIndex = rightIndex = apexIndex;
+						i = apexIndex;
+						continue;
+					}
+				}
+
+				// try to narrow the left side of the funnel
+				if (Cross2D(apex, funnelLeft, portal.left) <= 0.0f) {
+					if (Equal2D(apex, funnelLeft) || Cross2D(apex, funnelRight, portal.left) >= 0.0f) {
+						funnelLeft = portal.left;
+						leftIndex = i;
+					} else {
+						// the left side crossed over the right - the right corner is on the path
+						apex = funnelRight;
+						apexIndex = rightIndex;
+						out->Append(apex);
+
+						funnelLeft = funnelRight = apex;
+						leftIndex = rightIndex = apexIndex;
+						i = apexIndex;
+						continue;
+					}
+				}
+			}
+			out->Append(to);
+		}
+	}
+
+	std::size_t SmoothPath(const NavigationMap& map, std::span<const std::uint32_t> corridor, const Vector& start, const Vector& goal, std::span<Vector> waypoints) {
+		if (corridor.empty())
+			return 0;
+
+		// make sure the corridor is connected before we start writing
+		for (std::size_t i = 1; i < corridor.size(); ++i) {
+			if (map.FindLink(corridor[i - 1], corridor[i]) == Invalid_Index)
+				return 0;
+		}
+
+		WaypointWriter out{ waypoints };
+		out.Append(start);
+
+		// smooth each stretch between forced transitions separately
+		Vector segmentStart = start;
+		std::size_t first = 1;
+		for (std::size_t i = 1; i < corridor.size(); ++i) {
+			Vector entry, exit;
+			if (!GetForcedTransition(map, map.FindLink(corridor[i - 1], corridor[i]), &entry, &exit))
+				continue;
+
+			StringPull(map, corridor, first, i - 1, segmentStart, entry, &out);
+			out.Append(exit);
+
+			segmentStart = exit;
+			first = i + 1;
+		}
+		StringPull(map, corridor, first, corridor.size() - 1, segmentStart, goal, &out);
+
+		return out.count;
+	}
+}
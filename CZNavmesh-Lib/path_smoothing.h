@@ -0,0 +1,20 @@
+#pragma once
+#include "navigation_map.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace navmesh {
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * Turn a corridor of adjacent areas, as found by PathSearch or IncrementalPathPlanner, into the shortest
+	 * polyline through the portals between them (the "simple stupid funnel" algorithm).
+	 * Ladders and jumps cannot be cut across, so the points where they are entered and left are always kept.
+	 *
+	 * The polyline, including 'start' and 'goal', is written to 'waypoints' and the number of points written is
+	 * returned. If the buffer is too small the polyline is truncated. Returns zero if two consecutive areas of
+	 * the corridor are not connected. Nothing is allocated.
+	 */
+	std::size_t SmoothPath(const NavigationMap& map, std::span<const std::uint32_t> corridor, const Vector& start, const Vector& goal, std::span<Vector> waypoints);
+}
@@ -0,0 +1,143 @@
+#include "place_index.h"
+#include "navigation_map.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace navmesh {
+	namespace {
+		/// the place an area is indexed under; numbers no name was ever given to count as none
+		Place GetIndexedPlace(const NavArea* area) {
+			return area->m_place <= Max_Place ? area->m_place : Undefined_Place;
+		}
+	}
+
+	void PlaceIndex::Build(const NavigationMap& map) {
+		Clear();
+
+		constexpr std::size_t Place_Count = Max_Place + 1;
+		const auto Area_Count = map.GetAreaCount();
+
+		// group the areas by place; they are visited in index order, so each group is sorted
+		m_areaStart.assign(Place_Count + 1, 0);
+		for (std::uint32_t i = 0; i < Area_Count; ++i)
+			++m_areaStart[GetIndexedPlace(map.GetAreaByIndex(i)) + 1];
+		for (std::size_t place = 0; place < Place_Count; ++place)
+			m_areaStart[place + 1] += m_areaStart[place];
+
+		m_areas.resize(Area_Count);
+		std::vector<std::uint32_t> next(m_areaStart.begin(), m_areaStart.end() - 1);
+		for (std::uint32_t i = 0; i < Area_Count; ++i)
+			m_areas[next[GetIndexedPlace(map.GetAreaByIndex(i))]++] = i;
+
+		m_info.resize(Place_Count);
+		for (Place place = 0; place < Place_Count; ++place) {
+			const auto Areas = GetAreas(place);
+			if (Areas.empty())
+				continue;
+
+			if (place != Undefined_Place)
+				m_places.push_back(place);
+
+			PlaceInfo& info = m_info[place];
+			info.lo = Vector(std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity());
+			info.hi = -info.lo;
+			Vector weighted(0, 0, 0);
+			for (const std::uint32_t Index : Areas) {
+				const NavArea* area = map.GetAreaByIndex(Index);
+				info.lo.x = (std::min)(info.lo.x, area->m_extent.lo.x);
+				info.lo.y = (std::min)(info.lo.y, area->m_extent.lo.y);
+				info.lo.z = (std::min)(info.lo.z, area->m_extent.lo.z);
+				info.hi.x = (std::max)(info.hi.x, area->m_extent.hi.x);
+				info.hi.y = (std::max)(info.hi.y, area->m_extent.hi.y);
+				info.hi.z = (std::max)(info.hi.z, area->m_extent.hi.z);
+
+				// degenerate areas still count, so a place made only of them has a centroid
+				const float Size = (std::max)((area->m_extent.hi.x - area->m_extent.lo.x) * (area->m_extent.hi.y - area->m_extent.lo.y), 1.0f);
+				weighted = weighted + area->m_center * Size;
+				info.size += Size;
+			}
+			info.centroid = weighted / info.size;
+
+			// the centroid of a bent place can fall outside of it, so stand in the nearest of its areas instead
+			float closest = std::numeric_limits<float>::infinity();
+			for (const std::uint32_t Index : Areas) {
+				const float Distance = (map.GetAreaByIndex(Index)->m_center - info.centroid).Length();
+				if (Distance < closest) {
+					closest = Distance;
+					info.representativeArea = Index;
+				}
+			}
+			info.representativePoint = map.GetAreaByIndex(info.representativeArea)->m_center;
+		}
+
+		// two places border each other if an area of one connects to an area of the other, either way
+		std::vector<std::pair<Place, Place>> borders;
+		for (std::uint32_t i = 0; i < Area_Count; ++i) {
+			const NavArea* area = map.GetAreaByIndex(i);
+			const Place From = GetIndexedPlace(area);
+			if (From == Undefined_Place)
+				continue;
+
+			for (auto& connections : area->m_connect) {
+				for (auto& connect : connections) {
+					const NavArea* to = map.GetArea(connect);
+					const Place To = to != nullptr ? GetIndexedPlace(to) : Undefined_Place;
+					if (To != Undefined_Place && To != From) {
+						borders.emplace_back(From, To);
+						borders.emplace_back(To, From);
+					}
+				}
+			}
+		}
+		std::sort(borders.begin(), borders.end());
+		borders.erase(std::unique(borders.begin(), borders.end()), borders.end());
+
+		m_neighborStart.assign(Place_Count + 1, 0);
+		m_neighbors.reserve(borders.size());
+		for (auto& [from, to] : borders) {
+			++m_neighborStart[from + 1];
+			m_neighbors.push_back(to);
+		}
+		for (std::size_t place = 0; place < Place_Count; ++place)
+			m_neighborStart[place + 1] += m_neighborStart[place];
+	}
+
+	void PlaceIndex::Clear() {
+		m_areaStart.clear();
+		m_areas.clear();
+		m_info.clear();
+		m_neighborStart.clear();
+		m_neighbors.clear();
+		m_places.clear();
+	}
+
+	std::span<const std::uint32_t> PlaceIndex::GetAreas(Place place) const {
+		if (place > Max_Place || m_areaStart.empty())
+			return {};
+
+		return { m_areas.data() + m_areaStart[place], m_areas.data() + m_areaStart[place + 1] };
+	}
+
+	const PlaceIndex::PlaceInfo* PlaceIndex::GetInfo(Place place) const {
+		return GetAreas(place).empty() ? nullptr : &m_info[place];
+	}
+
+	std::span<const Place> PlaceIndex::GetNeighbors(Place place) const {
+		if (place > Max_Place || m_neighborStart.empty())
+			return {};
+
+		return { m_neighbors.data() + m_neighborStart[place], m_neighbors.data() + m_neighborStart[place + 1] };
+	}
+
+	bool PlaceIndex::AreNeighbors(Place a, Place b) const {
+		const auto Neighbors = GetNeighbors(a);
+		return std::binary_search(Neighbors.begin(), Neighbors.end(), b);
+	}
+
+	std::size_t PlaceIndex::GetMemoryUsage() const {
+		auto vectorBytes = [](const auto& v) { return v.capacity() * sizeof(v[0]); };
+		return vectorBytes(m_areaStart) + vectorBytes(m_areas) + vectorBytes(m_info) + vectorBytes(m_neighborStart) + vectorBytes(m_neighbors) + vectorBytes(m_places);
+	}
+}
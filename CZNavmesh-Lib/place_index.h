@@ -0,0 +1,58 @@
+#pragma once
+#include <extdll.h>
+
+#include "place_names.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace navmesh {
+	class NavigationMap;
+
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * The areas of each place, and which places border each other, built once per map so questions about a
+	 * place do not have to sweep every area.
+	 * Places are looked up directly by their number; areas without a place are grouped under Undefined_Place,
+	 * which borders nothing.
+	 */
+	class PlaceIndex {
+	public:
+		struct PlaceInfo {
+			Vector lo, hi;										///< bounding box of the areas of the place
+			Vector centroid;									///< center of the areas, weighted by their size; may be off the mesh
+			Vector representativePoint;							///< center of the area closest to the centroid, on the mesh
+			std::uint32_t representativeArea;					///< dense index of that area
+			float size;											///< summed 2D size of the areas
+		};
+
+		/// (re)build the index from the areas of a loaded map
+		void Build(const NavigationMap& map);
+		void Clear();
+
+		/// dense indices of the areas of 'place', in ascending order
+		std::span<const std::uint32_t> GetAreas(Place place) const;
+
+		/// return nullptr if 'place' has no area
+		const PlaceInfo* GetInfo(Place place) const;
+
+		/// places with at least one area connected to an area of 'place', in ascending order
+		std::span<const Place> GetNeighbors(Place place) const;
+		bool AreNeighbors(Place a, Place b) const;
+
+		/// places having at least one area, in ascending order, Undefined_Place excluded
+		std::span<const Place> GetPlaces() const noexcept { return m_places; }
+
+		std::size_t GetMemoryUsage() const;
+
+	private:
+		std::vector<std::uint32_t> m_areaStart{};				///< first area of each place, plus one past the end
+		std::vector<std::uint32_t> m_areas{};					///< area indices grouped by place
+		std::vector<PlaceInfo> m_info{};						///< by place
+		std::vector<std::uint32_t> m_neighborStart{};			///< first neighbor of each place, plus one past the end
+		std::vector<Place> m_neighbors{};
+		std::vector<Place> m_places{};
+	};
+}
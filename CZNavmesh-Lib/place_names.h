@@ -0,0 +1,147 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+namespace navmesh {
+	/**
+	 * A place is a named group of navigation areas
+	 */
+	using Place = std::uint32_t;
+	constexpr Place Undefined_Place = 0u;	// ie: "no place"
+	constexpr Place Any_Place = 0xFFFF;
+
+	/// names of the places a .nav file may use, indexed by Place - 1
+	inline constexpr std::string_view Place_Names[] = {
+		"BombsiteA", "BombsiteB", "BombsiteC", "Hostages", "HostageRescueZone", "VipRescueZone",
+		"CTSpawn", "TSpawn", "Bridge", "Middle", "House", "Apartment",
+		"Apartments", "Market", "Sewers", "Tunnel", "Ducts", "Village",
+		"Roof", "Upstairs", "Downstairs", "Basement", "Crawlspace", "Kitchen",
+		"Inside", "Outside", "Tower", "WineCellar", "Garage", "Courtyard",
+		"Water", "FrontDoor", "BackDoor", "SideDoor", "BackWay", "FrontYard",
+		"BackYard", "SideYard", "Lobby", "Vault", "Elevator", "DoubleDoors",
+		"SecurityDoors", "LongHall", "SideHall", "FrontHall", "BackHall", "MainHall",
+		"FarSide", "Windows", "Window", "Attic", "StorageRoom", "ProjectorRoom",
+		"MeetingRoom", "ConferenceRoom", "ComputerRoom", "BigOffice", "LittleOffice", "Dumpster",
+		"Airplane", "Underground", "Bunker", "Mines", "Front", "Back",
+		"Rear", "Side", "Ramp", "Underpass", "Overpass", "Stairs",
+		"Ladder", "Gate", "GateHouse", "LoadingDock", "GuardHouse", "Entrance",
+		"VendingMachines", "Loft", "Balcony", "Alley", "BackAlley", "SideAlley",
+		"FrontRoom", "BackRoom", "SideRoom", "Crates", "Truck", "Bedroom",
+		"FamilyRoom", "Bathroom", "LivingRoom", "Den", "Office", "Atrium",
+		"Entryway", "Foyer", "Stairwell", "Fence", "Deck", "Porch",
+		"Patio", "Wall"
+	};
+
+	/// the highest place a .nav file may use
+	constexpr Place Max_Place = static_cast<Place>(std::size(Place_Names));
+
+	//--------------------------------------------------------------------------------------------------------------
+	/**
+	 * A perfect hash of Place_Names, built by the compiler: each name hashes to a bucket, and each bucket has
+	 * the seed that mixes the hashes of all of its names into free slots. Finding a place takes one hash of the
+	 * name and one comparison.
+	 */
+	struct PlaceHashTable {
+		static constexpr std::size_t Bucket_Count = 64;
+		static constexpr std::size_t Slot_Count = 256;			///< a power of two
+
+		std::array<std::uint8_t, Bucket_Count> seeds{};
+		std::array<std::uint8_t, Slot_Count> slots{};			///< place whose name hashes here, 0 if none
+		bool complete{};										///< a seed was found for every bucket
+
+		/// FNV-1a
+		static constexpr std::uint32_t Hash(std::string_view name) noexcept {
+			std::uint32_t hash = 2166136261u;
+			for (const char C : name)
+				hash = (hash ^ static_cast<std::uint8_t>(C)) * 16777619u;
+			return hash ^ (hash >> 15);
+		}
+
+		static constexpr std::size_t GetBucket(std::uint32_t hash) noexcept { return hash % Bucket_Count; }
+
+		/// the names of a bucket share the low bits of their hash, so the high bits are folded in before mixing
+		static constexpr std::size_t GetSlot(std::uint32_t hash, std::uint8_t seed) noexcept {
+			hash = (hash ^ (hash >> 16) ^ ((seed + 1u) * 0x9E3779B9u)) * 0x85EBCA6Bu;
+			return (hash ^ (hash >> 13)) & (Slot_Count - 1);
+		}
+
+		/**
+		 * Each name is hashed once, and the seeds are tried on the names of one bucket at a time, which keeps
+		 * the evaluation far below the step limits of the compilers (100000 by default for MSVC).
+		 */
+		static constexpr PlaceHashTable Build() {
+			PlaceHashTable table{};
+
+			// hash each name, and group the names by bucket; the work arrays are plain arrays, which the compiler
+			// indexes without evaluating a call
+			std::uint32_t hashes[Max_Place]{};
+			std::uint8_t bucketStart[Bucket_Count + 1]{};
+			for (Place place = 1; place <= Max_Place; ++place) {
+				hashes[place - 1] = Hash(Place_Names[place - 1]);
+				++bucketStart[GetBucket(hashes[place - 1]) + 1];
+			}
+			for (std::size_t bucket = 0; bucket < Bucket_Count; ++bucket)
+				bucketStart[bucket + 1] += bucketStart[bucket];
+
+			std::uint8_t members[Max_Place]{};					///< places grouped by bucket
+			std::uint8_t next[Bucket_Count]{};
+			for (std::size_t bucket = 0; bucket < Bucket_Count; ++bucket)
+				next[bucket] = bucketStart[bucket];
+			for (Place place = 1; place <= Max_Place; ++place)
+				members[next[GetBucket(hashes[place - 1])]++] = static_cast<std::uint8_t>(place);
+
+			// with more than twice as many slots as names, the buckets can be placed in any order
+			table.complete = true;
+			std::size_t slot[Max_Place]{};
+			for (std::size_t bucket = 0; bucket < Bucket_Count; ++bucket) {
+				const std::size_t First = bucketStart[bucket];
+				const std::size_t Size = bucketStart[bucket + 1] - First;
+
+				bool placed = Size == 0;
+				for (unsigned seed = 0; seed < 256 && !placed; ++seed) {
+					placed = true;
+					for (std::size_t i = 0; i < Size && placed; ++i) {
+						slot[i] = GetSlot(hashes[members[First + i] - 1], static_cast<std::uint8_t>(seed));
+						placed = table.slots[slot[i]] == 0;
+						for (std::size_t j = 0; j < i && placed; ++j)
+							placed = slot[j] != slot[i];
+					}
+
+					if (placed) {
+						table.seeds[bucket] = static_cast<std::uint8_t>(seed);
+						for (std::size_t i = 0; i < Size; ++i)
+							table.slots[slot[i]] = members[First + i];
+					}
+				}
+				table.complete = table.complete && placed;
+			}
+			return table;
+		}
+	};
+
+	static_assert(Max_Place < 256, "places are stored as bytes in PlaceHashTable");
+	inline constexpr PlaceHashTable Place_Hash_Table = PlaceHashTable::Build();
+	static_assert(Place_Hash_Table.complete, "no perfect hash found for Place_Names, change the hash or the table size");
+
+	/// return the place with this name, Undefined_Place if there is none
+	constexpr Place FindPlace(std::string_view name) noexcept {
+		const std::uint32_t Hash = PlaceHashTable::Hash(name);
+		const Place Candidate = Place_Hash_Table.slots[PlaceHashTable::GetSlot(Hash, Place_Hash_Table.seeds[PlaceHashTable::GetBucket(Hash)])];
+		return Candidate != Undefined_Place && Place_Names[Candidate - 1] == name ? Candidate : Undefined_Place;
+	}
+
+	/// return the name of a place, an empty string if it has none; the name is null terminated
+	constexpr std::string_view GetPlaceName(Place place) noexcept {
+		return place != Undefined_Place && place <= Max_Place ? Place_Names[place - 1] : std::string_view{};
+	}
+
+	static_assert([] {
+		for (Place place = 1; place <= Max_Place; ++place) {
+			if (FindPlace(Place_Names[place - 1]) != place || GetPlaceName(place) != Place_Names[place - 1])
+				return false;
+		}
+		return FindPlace("Nowhere") == Undefined_Place && FindPlace("") == Undefined_Place;
+	}());
+}
@@ -12,7 +12,16 @@
 #include <format>
 #include <numbers>
 #include <format>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <utility>
 #include "CZNavmesh-Lib/navigation_map.h"
+#include "CZNavmesh-Lib/nav_benchmark.h"
+#include "CZNavmesh-Lib/entity_class_table.h"
+#include "CZNavmesh-Lib/nav_loader.h"
+#include "CZNavmesh-Lib/nav_snapshots.h"
+#include "CZNavmesh-Lib/nav_map_cache.h"
 
 edict_t* host{};
 
@@ -28,13 +37,14 @@ meta_globals_t* gpMetaGlobals;
 
 DLL_FUNCTIONS func_table;
 DLL_FUNCTIONS gFunctionTable_Post;
+NEW_DLL_FUNCTIONS new_func_table;
 
 META_FUNCTIONS gMetaFunctionTable{
     nullptr, // pfnGetEntityAPI()
     nullptr, // pfnGetEntityAPI_Post()
     GetEntityAPI2, // pfnGetEntityAPI2()
     GetEntityAPI2_Post, // pfnGetEntityAPI2_Post()
-    nullptr, // pfnGetNewDLLFunctions()
+    GetNewDLLFunctions, // pfnGetNewDLLFunctions()
     nullptr, // pfnGetNewDLLFunctions_Post()
     GetEngineFunctions, // pfnGetEngineFunctions()
     nullptr,            // pfnGetEngineFunctions_Post()
@@ -76,7 +86,51 @@ plugin_info_t Plugin_info{
     PT_ANYTIME,                                 // when unloadable
 };
 
-navmesh::NavigationMap navigation_map{};
+navmesh::NavSnapshots navigation_maps{}; // the game thread is a reader, quiescent at the start of each frame
+navmesh::NavSnapshots::ReaderId game_thread_reader = navmesh::NavSnapshots::No_Reader;
+navmesh::AsyncNavLoader nav_loader{};
+navmesh::AsyncNavLoader nav_preloader{}; // reads the next map of the mapcycle while this one is played
+navmesh::NavMapCache nav_map_cache{};
+navmesh::AreaBlocking area_blocking{}; // which areas of the current map are blocked, game thread only
+
+// make 'map' the current one; every area of a new map starts out enabled
+void PublishMap(std::unique_ptr<navmesh::NavigationMap> map) {
+    area_blocking.Reset(map->GetAreaCount());
+    navigation_maps.Publish(std::move(map));
+}
+
+std::vector<std::string> GetNavPaths(const std::string& map) {
+    return { std::format("cstrike/maps/{}.nav", map), std::format("czero/maps/{}.nav", map) };
+}
+
+// attach a cached map to the current level and switch to it; return false if none is cached
+bool PublishCachedMap(const std::vector<std::string>& paths) {
+    for (auto& path : paths) {
+        if (auto map = nav_map_cache.Take(path); map != nullptr && map->AttachToLevel()) {
+            PublishMap(std::move(map));
+            SERVER_PRINT(std::format("Navmesh: Loaded the nav file {} from the cache.\n", path).c_str());
+            return true;
+        }
+    }
+    return false;
+}
+
+void PreloadNextMap() {
+    const std::string Mapcycle = CVAR_GET_STRING("mapcyclefile");
+    std::string next = navmesh::GetNextMapInCycle("cstrike/" + Mapcycle, STRING(gpGlobals->mapname));
+    if (next.empty())
+        next = navmesh::GetNextMapInCycle("czero/" + Mapcycle, STRING(gpGlobals->mapname));
+
+    if (next.empty() || next == STRING(gpGlobals->mapname))
+        return;
+
+    const auto Paths = GetNavPaths(next);
+    if (std::any_of(Paths.begin(), Paths.end(), [](const std::string& path) { return nav_map_cache.Contains(path); }))
+        return;
+
+    // only the mesh, since the ladders need the entities of that level
+    nav_preloader.Start(Paths, true);
+}
 
 BOOL APIENTRY DllMain( HMODULE hModule,
                        DWORD  ul_reason_for_call,
@@ -191,9 +245,30 @@ C_DLLEXPORT int Meta_Attach(PLUG_LOADTIME now, META_FUNCTIONS* pFunctionTable, m
     LOG_CONSOLE(PLID, "%s: plugin attaching", Plugin_info.name);
     LOG_MESSAGE(PLID, "%s: plugin attaching", Plugin_info.name);
 
+    game_thread_reader = navigation_maps.RegisterReader();
+
     REG_SVR_COMMAND("loadnav", [] {
-        if (!navigation_map.Load(std::format("cstrike/maps/{}.nav", STRING(gpGlobals->mapname)))) {
-            if (!navigation_map.Load(std::format("czero/maps/{}.nav", STRING(gpGlobals->mapname)))) {
+        const auto Paths = GetNavPaths(STRING(gpGlobals->mapname));
+        if (PublishCachedMap(Paths)) {
+            nav_loader.Cancel();
+            return;
+        }
+
+        // "loadnav async" keeps the server running while the map loads, see StartFrame
+        if (CMD_ARGC() > 1 && strcmp(CMD_ARGV(1), "async") == 0) {
+            if (nav_loader.Start(Paths)) {
+                SERVER_PRINT("Navmesh: Loading the nav file in the background.\n");
+            } else {
+                SERVER_PRINT("Navmesh: A nav file is already loading.\n");
+            }
+            return;
+        }
+
+        // the map being read stays as it is until the new one is published
+        nav_loader.Cancel();
+        auto map = std::make_unique<navmesh::NavigationMap>();
+        if (!map->Load(Paths[0])) {
+            if (!map->Load(Paths[1])) {
                 SERVER_PRINT("Navmesh: Failed to load the nav file.");
                 return;
             } else {
@@ -202,16 +277,89 @@ C_DLLEXPORT int Meta_Attach(PLUG_LOADTIME now, META_FUNCTIONS* pFunctionTable, m
         } else {        
             SERVER_PRINT("Navmesh: Loaded the nav file from cstrike.");
         }
+        PublishMap(std::move(map));
     });
 
     REG_SVR_COMMAND("getnav", [] {
-        auto mesh = navigation_map.GetNavArea(&host->v.origin);
+        auto mesh = navigation_maps.Read()->GetNavArea(&host->v.origin);
         if (mesh != nullptr) {
-            SERVER_PRINT(std::format("NavID: {}\n", mesh->m_id).c_str());
+            const std::string_view Place_Name = navmesh::GetPlaceName(mesh->m_place);
+            SERVER_PRINT(std::format("NavID: {} Place: {}\n", mesh->m_id, Place_Name.empty() ? "none" : Place_Name).c_str());
         } else {
             SERVER_PRINT("Could not get the navigation mesh.\n");
         }
     });
+
+    REG_SVR_COMMAND("navbench", [] {
+        std::string report{};
+        const auto Map = navigation_maps.Read();
+        navmesh::BenchmarkPathSmoothing(*Map, &report);
+        navmesh::BenchmarkCorridorRepair(*Map, &report);
+        navmesh::BenchmarkIncrementalRepair(*Map, &report);
+        navmesh::BenchmarkBidirectionalSearch(*Map, &report);
+        navmesh::BenchmarkVisibility(*Map, &report);
+        navmesh::BenchmarkWalkableLine(*Map, &report);
+        navmesh::BenchmarkGroundHeight(*Map, &report);
+        navmesh::BenchmarkSharedImage(*Map, &report);
+        navmesh::BenchmarkAreaOrder(*Map, &report);
+        navmesh::BenchmarkMergedAreas(*Map, &report);
+        navmesh::BenchmarkLazyDecoding(*Map, &report);
+        navmesh::BenchmarkPlaceIndex(*Map, &report);
+        SERVER_PRINT(report.c_str());
+    });
+
+    // "savenav [hilbert|bfs|file]" rewrites the nav file of this map with its areas in that order
+    REG_SVR_COMMAND("savenav", [] {
+        const auto Map = navigation_maps.Read();
+        if (Map->GetAreaCount() == 0) {
+            SERVER_PRINT("Navmesh: No navigation map is loaded.\n");
+            return;
+        }
+
+        const char* order_name = CMD_ARGC() > 1 ? CMD_ARGV(1) : "hilbert";
+        navmesh::NavAreaOrderType order = navmesh::HILBERT_AREA_ORDER;
+        if (strcmp(order_name, "bfs") == 0) {
+            order = navmesh::BFS_AREA_ORDER;
+        } else if (strcmp(order_name, "file") == 0) {
+            order = navmesh::FILE_AREA_ORDER;
+        } else if (strcmp(order_name, "hilbert") != 0) {
+            SERVER_PRINT("Navmesh: Usage: savenav [hilbert|bfs|file]\n");
+            return;
+        }
+
+        // read the mesh again, since the loaded one may be numbered in another order
+        navmesh::NavigationMap copy{};
+        copy.SetAreaOrder(order);
+        if (!copy.LoadMesh(Map->GetPath()) || !copy.Save(Map->GetPath())) {
+            SERVER_PRINT(std::format("Navmesh: Failed to save {}.\n", Map->GetPath()).c_str());
+            return;
+        }
+        SERVER_PRINT(std::format("Navmesh: Saved {} with its areas in {} order.\n", Map->GetPath(), order_name).c_str());
+    });
+
+    // "mergenav" rewrites the nav file of this map with the areas that make a flat rectangle merged into one
+    REG_SVR_COMMAND("mergenav", [] {
+        const auto Map = navigation_maps.Read();
+        if (Map->GetAreaCount() == 0) {
+            SERVER_PRINT("Navmesh: No navigation map is loaded.\n");
+            return;
+        }
+
+        navmesh::NavigationMap copy{};
+        if (!copy.LoadMesh(Map->GetPath())) {
+            SERVER_PRINT(std::format("Navmesh: Failed to read {}.\n", Map->GetPath()).c_str());
+            return;
+        }
+
+        const std::uint32_t area_count = copy.GetAreaCount();
+        const std::uint32_t merged = copy.MergeAreas();
+        if (!copy.Save(Map->GetPath())) {
+            SERVER_PRINT(std::format("Navmesh: Failed to save {}.\n", Map->GetPath()).c_str());
+            return;
+        }
+        SERVER_PRINT(std::format("Navmesh: Saved {} with {} of its {} areas merged, {} left; loadnav to use it.\n",
+            Map->GetPath(), merged, area_count, copy.GetAreaCount()).c_str());
+    });
     // ask the engine to register the server commands this plugin uses
     return (TRUE); // returning TRUE enables metamod to attach this plugin
 }
@@ -227,6 +375,9 @@ C_DLLEXPORT int Meta_Detach(PLUG_LOADTIME now, PL_UNLOAD_REASON reason) {
         LOG_ERROR(PLID, "%s: plugin NOT detaching (can't unload plugin right now)", Plugin_info.name);
         return (FALSE); // returning FALSE prevents metamod from unloading this plugin
     }
+    nav_loader.Cancel();
+    nav_preloader.Cancel();
+    navigation_maps.UnregisterReader(game_thread_reader);
     return (TRUE); // returning TRUE enables metamod to unload this plugin
 }
 
@@ -240,10 +391,39 @@ GiveFnptrsToDll(enginefuncs_t* pengfuncsFromEngine, globalvars_t* pGlobals) {
 
 C_DLLEXPORT int GetEntityAPI2(DLL_FUNCTIONS* pFunctionTable, int* interfaceVersion) {
     func_table.pfnStartFrame = []() -> void {
+        // nothing from the last frame is held anymore, so maps replaced since can go
+        navigation_maps.Quiescent(game_thread_reader);
+        std::vector<std::unique_ptr<navmesh::NavigationMap>> freed{};
+        navigation_maps.Reclaim(&freed);
+        for (auto& map : freed)
+            nav_map_cache.Insert(std::move(map));
+
+        constexpr std::chrono::milliseconds Load_Budget{ 2 };
+        switch (nav_loader.Update(Load_Budget)) {
+        case navmesh::AsyncNavLoader::LOAD_DONE: {
+            std::string path{};
+            PublishMap(nav_loader.TakeMap(&path));
+            SERVER_PRINT(std::format("Navmesh: Loaded the nav file {}.\n", path).c_str());
+            break;
+        }
+        case navmesh::AsyncNavLoader::LOAD_FAILED:
+            SERVER_PRINT("Navmesh: Failed to load the nav file.\n");
+            break;
+        default:
+            break;
+        }
+
+        if (nav_preloader.Update(Load_Budget) == navmesh::AsyncNavLoader::LOAD_DONE)
+            nav_map_cache.Insert(nav_preloader.TakeMap());
+
         RETURN_META(MRES_IGNORED); 
     };
     func_table.pfnGameInit = []() -> void { RETURN_META(MRES_IGNORED); };
-    func_table.pfnSpawn = [](edict_t* entity) -> int { RETURN_META_VALUE(MRES_IGNORED, 0); };
+    func_table.pfnSpawn = [](edict_t* entity) -> int {
+        // the edict may be reused, so classify it again for the traces
+        navmesh::entity_class_table.OnSpawn(entity);
+        RETURN_META_VALUE(MRES_IGNORED, 0);
+    };
     func_table.pfnClientConnect = [](edict_t* entity, const char* Name, const char* Address, char Reject_Reason[]) -> qboolean {
         if (gpGlobals->deathmatch) {
             // check if this client is the listen server client
@@ -256,8 +436,19 @@ C_DLLEXPORT int GetEntityAPI2(DLL_FUNCTIONS* pFunctionTable, int* interfaceVersi
     };
     func_table.pfnClientDisconnect = [](edict_t* entity) -> void { RETURN_META(MRES_IGNORED); };
     func_table.pfnClientPutInServer = [](edict_t* entity) -> void { RETURN_META(MRES_IGNORED); };
-    func_table.pfnServerActivate = [](edict_t* edictList, int edictCount, int) -> void { RETURN_META(MRES_IGNORED); };
+    func_table.pfnServerActivate = [](edict_t* edictList, int edictCount, int) -> void {
+        // the entities are spawned now, so a map loaded ahead of time can be attached
+        PublishCachedMap(GetNavPaths(STRING(gpGlobals->mapname)));
+        PreloadNextMap();
+        RETURN_META(MRES_IGNORED);
+    };
     func_table.pfnClientCommand = [](edict_t*) -> void { RETURN_META(MRES_IGNORED); };
+    func_table.pfnServerDeactivate = []() -> void {
+        // a load still running would trace against the entities of the map going away
+        nav_loader.Cancel();
+        navmesh::entity_class_table.Clear();
+        RETURN_META(MRES_IGNORED);
+    };
 
     memcpy(pFunctionTable, &func_table, sizeof(DLL_FUNCTIONS));
     return (TRUE);
@@ -268,6 +459,16 @@ C_DLLEXPORT int GetEntityAPI2_Post(DLL_FUNCTIONS* pFunctionTable, int* interface
     return (TRUE);
 }
 
+C_DLLEXPORT int GetNewDLLFunctions(NEW_DLL_FUNCTIONS* pFunctionTable, int* interfaceVersion) {
+    new_func_table.pfnOnFreeEntPrivateData = [](edict_t* entity) -> void {
+        navmesh::entity_class_table.OnFree(entity);
+        RETURN_META(MRES_IGNORED);
+    };
+
+    memcpy(pFunctionTable, &new_func_table, sizeof(NEW_DLL_FUNCTIONS));
+    return (TRUE);
+}
+
 C_DLLEXPORT int
 GetEngineFunctions(enginefuncs_t* pengfuncsFromEngine, int* interfaceVersion) {
     memcpy(pengfuncsFromEngine, &meta_engfuncs, sizeof(enginefuncs_t));
@@ -0,0 +1,118 @@
+#include <extdll.h>
+#include <vector>
+#include "navmesh_api.h"
+#include "CZNavmesh-Lib/navigation_map.h"
+#include "CZNavmesh-Lib/nav_snapshots.h"
+#include "CZNavmesh-Lib/path_search.h"
+
+extern navmesh::NavSnapshots navigation_maps;
+extern navmesh::AreaBlocking area_blocking;
+
+// the functions below are only called from the game thread, so they can share these
+namespace {
+    navmesh::PathSearch api_path_search{};
+    std::vector<std::uint32_t> api_path{};
+    std::vector<navmesh::HidingSpot*> api_spots{};
+
+    Vector ToVector(const navmesh_vec3* v) {
+        return Vector(v->x, v->y, v->z);
+    }
+
+    navmesh_vec3 ToVec3(const Vector& v) {
+        return { v.x, v.y, v.z };
+    }
+
+    uint32_t IndexOf(const navmesh::NavArea* area) {
+        return area != nullptr ? area->m_index : NAVMESH_INVALID_INDEX;
+    }
+
+    uint64_t GetMapSerial() {
+        return navigation_maps.Read()->GetAreaCount() > 0 ? navigation_maps.GetEpoch() : 0;
+    }
+
+    uint32_t GetAreaCount() {
+        return navigation_maps.Read()->GetAreaCount();
+    }
+
+    uint32_t GetArea(const navmesh_vec3* pos) {
+        const Vector Pos = ToVector(pos);
+        return IndexOf(navigation_maps.Read()->GetNavArea(&Pos));
+    }
+
+    uint32_t GetNearestArea(const navmesh_vec3* pos, int any_z) {
+        const Vector Pos = ToVector(pos);
+        return IndexOf(navigation_maps.Read()->GetNearestNavArea(&Pos, any_z != 0));
+    }
+
+    uint32_t GetAreaByID(uint32_t id) {
+        return IndexOf(navigation_maps.Read()->GetNavAreaByID(id));
+    }
+
+    int GetAreaInfo(uint32_t index, navmesh_area_info* info) {
+        const auto Map = navigation_maps.Read();
+        if (index >= Map->GetAreaCount() || info == nullptr)
+            return 0;
+
+        const navmesh::NavArea* area = Map->GetAreaByIndex(index);
+        info->id = area->m_id;
+        info->index = area->m_index;
+        info->center = ToVec3(area->m_center);
+        info->lo = ToVec3(area->m_extent.lo);
+        info->hi = ToVec3(area->m_extent.hi);
+        info->place = area->m_place;
+        info->attributes = area->m_attributeFlags;
+        return 1;
+    }
+
+    uint32_t GetPlace(const navmesh_vec3* pos) {
+        const Vector Pos = ToVector(pos);
+        return navigation_maps.Read()->GetPlace(&Pos);
+    }
+
+    const char* GetPlaceName(uint32_t place) {
+        const std::string_view Name = navmesh::GetPlaceName(place);
+        return Name.empty() ? nullptr : Name.data();
+    }
+
+    uint32_t FindPath(uint32_t from, uint32_t to, uint32_t* path, uint32_t capacity) {
+        if (!api_path_search.Find(*navigation_maps.Read(), from, to, &api_path, &area_blocking))
+            return 0;
+
+        const auto Length = static_cast<uint32_t>(api_path.size());
+        for (uint32_t i = 0; i < Length && i < capacity; ++i)
+            path[i] = api_path[i];
+        return Length;
+    }
+
+    uint32_t FindHidingSpots(const navmesh_vec3* pos, float radius, uint32_t flags, navmesh_hiding_spot* spots, uint32_t capacity) {
+        const auto Map = navigation_maps.Read();
+        const auto& Index = Map->GetHidingSpotIndex();
+        Index.FindInRadius(ToVector(pos), radius, static_cast<unsigned char>(flags), &api_spots);
+
+        const auto Count = static_cast<uint32_t>(api_spots.size());
+        for (uint32_t i = 0; i < Count && i < capacity; ++i) {
+            const navmesh::HidingSpot* spot = api_spots[i];
+            spots[i] = { ToVec3(spot->m_pos), spot->m_id, spot->m_flags, Index.GetSpotArea(spot) };
+        }
+        return Count;
+    }
+
+    const navmesh_api api_table = {
+        NAVMESH_API_VERSION,
+        sizeof(navmesh_api),
+        GetMapSerial,
+        GetAreaCount,
+        GetArea,
+        GetNearestArea,
+        GetAreaByID,
+        GetAreaInfo,
+        GetPlace,
+        FindPath,
+        FindHidingSpots,
+        GetPlaceName,
+    };
+}
+
+C_DLLEXPORT const navmesh_api* GetNavmeshAPI(uint32_t version) {
+    return version <= NAVMESH_API_VERSION ? &api_table : nullptr;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * C interface to the navigation map owned by this plugin, so other plugins can query it without loading
+ * their own copy. Fetch it once at attach time:
+ *
+ *     navmesh_get_api_fn get_api = (navmesh_get_api_fn)GetProcAddress(GetModuleHandleA("CZNavmesh.dll"), "GetNavmeshAPI");
+ *     const navmesh_api* api = get_api ? get_api(NAVMESH_API_VERSION) : NULL;
+ *
+ * Every function must be called from the game thread. Areas are named by their dense index, which is only
+ * meaningful for the map it came from; when get_map_serial() changes, the map was replaced and any index
+ * kept from before must be looked up again.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NAVMESH_API_VERSION 2
+#define NAVMESH_INVALID_INDEX 0xFFFFFFFFu
+
+typedef struct navmesh_vec3 {
+    float x, y, z;
+} navmesh_vec3;
+
+typedef struct navmesh_area_info {
+    uint32_t id;            // area ID from the .nav file
+    uint32_t index;         // dense index, as taken and returned by the other functions
+    navmesh_vec3 center;
+    navmesh_vec3 lo;        // extents of the area
+    navmesh_vec3 hi;
+    uint32_t place;         // place ID from the .nav file, 0 if none
+    uint32_t attributes;    // NavAttributeType flags
+} navmesh_area_info;
+
+typedef struct navmesh_hiding_spot {
+    navmesh_vec3 pos;
+    uint32_t id;
+    uint32_t flags;         // HidingSpot flags: 1 in cover, 2 good sniper spot, 4 ideal sniper spot
+    uint32_t area;          // dense index of the area the spot belongs to
+} navmesh_hiding_spot;
+
+typedef struct navmesh_api {
+    uint32_t version;       // NAVMESH_API_VERSION of the plugin providing this table
+    uint32_t size;          // sizeof(navmesh_api) of the provider; later versions only append functions
+
+    // changes every time the map is replaced, 0 while no map is loaded
+    uint64_t (*get_map_serial)(void);
+    uint32_t (*get_area_count)(void);
+
+    // area containing 'pos', or NAVMESH_INVALID_INDEX
+    uint32_t (*get_area)(const navmesh_vec3* pos);
+
+    // area containing 'pos', or the closest one it can reach; 'any_z' ignores the height of the areas
+    uint32_t (*get_nearest_area)(const navmesh_vec3* pos, int any_z);
+    uint32_t (*get_area_by_id)(uint32_t id);
+
+    // return 0 if 'area' is not a valid index
+    int (*get_area_info)(uint32_t area, navmesh_area_info* info);
+
+    // place ID at 'pos', 0 if none
+    uint32_t (*get_place)(const navmesh_vec3* pos);
+
+    // cheapest path between two areas, both included; return its length, 0 if there is none, and write at
+    // most 'capacity' areas to 'path'
+    uint32_t (*find_path)(uint32_t from, uint32_t to, uint32_t* path, uint32_t capacity);
+
+    // hiding spots within 'radius' of 'pos' having one of 'flags' (0 for any), closest first; return how many
+    // were found, and write at most 'capacity' of them to 'spots'
+    uint32_t (*find_hiding_spots)(const navmesh_vec3* pos, float radius, uint32_t flags, navmesh_hiding_spot* spots, uint32_t capacity);
+
+    // since version 2: name of a place ID, such as "BombsiteA", or NULL if it has none; the string is static
+    const char* (*get_place_name)(uint32_t place);
+} navmesh_api;
+
+// exported as GetNavmeshAPI; return NULL if 'version' is newer than the one provided
+typedef const navmesh_api* (*navmesh_get_api_fn)(uint32_t version);
+
+#ifdef __cplusplus
+}
+#endif